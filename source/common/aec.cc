@@ -57,9 +57,9 @@ int      symbolCount = 0;
 #endif
 
 #if CTRL_OPT_AEC
-/* [8 * lg_pmps + 4 * mps + cycno] */
-static context_t g_tab_ctx_mps[2048 * 4 * 2];
-static context_t g_tab_ctx_lps[2048 * 4 * 2];
+/* next state of a context: [2 * (8 * lg_pmps + 4 * mps + cycno) + is_LPS].
+ * the MPS and LPS transitions of a state share a cache line */
+static context_t g_tab_ctx_next[2 * MAKE_CONTEXT(1024, 1, 3) + 2];
 #endif
 
 /* ---------------------------------------------------------------------------
@@ -154,85 +154,129 @@ static const int8_t tab_intra_mode_luma2chroma[NUM_INTRA_MODE] = {
 
 
 /* ---------------------------------------------------------------------------
+ * refill the bit window (called with less than 32 bits left in it).
+ * i_byte_buf holds the next i_bits_to_go bits of the stream from its MSB,
+ * the bits below them are zero
  */
 static ALWAYS_INLINE
-int aec_get_next_bit(aec_t *p_aec)
+void aec_refill(aec_t *p_aec)
 {
-    uint32_t next_bit;
-
-    if (--p_aec->i_bits_to_go < 0) {
-        int diff = p_aec->i_bytes - p_aec->i_byte_pos;
-        uint8_t *p_buffer = p_aec->p_buffer + p_aec->i_byte_pos;
-
-#if 1
-        if (diff > 7) {
-            p_aec->i_byte_buf = ((uint64_t)p_buffer[0] << 56) | ((uint64_t)p_buffer[1] << 48) | ((uint64_t)p_buffer[2] << 40) | ((uint64_t)p_buffer[3] << 32) |
-                                ((uint64_t)p_buffer[4] << 24) | ((uint64_t)p_buffer[5] << 16) | ((uint64_t)p_buffer[6] <<  8) |  (uint64_t)p_buffer[7];
-            p_aec->i_bits_to_go = 63;
-            p_aec->i_byte_pos += 8;
-        } else if (diff > 0) {
-            /* һ֡ʣС8һ֡ͼֻһ */
-            int i;
-            p_aec->i_bits_to_go += (int8_t)(diff << 3);
-            p_aec->i_byte_pos += (p_aec->i_bits_to_go + 1) >> 3;
-
-            p_aec->i_byte_buf = 0;
-            for (i = 0; i < diff; i++) {
-                p_aec->i_byte_buf = (p_aec->i_byte_buf << 8) | p_buffer[i];
-            }
-        } else {
-            p_aec->b_bit_error = 1;
-            return 1;
-        }
-#else
-        int i;
-        if (diff > 8) {
-            diff = 8;
-        } else if (diff <= 0) {
-            p_aec->b_bit_error = 1;
-            return 1;
+    const uint8_t *p_buffer = p_aec->p_buffer + p_aec->i_byte_pos;
+    int num_left = p_aec->i_bytes - p_aec->i_byte_pos;
+    int num_bits = p_aec->i_bits_to_go;
+
+    if (num_left > 7) {
+        /* as many whole bytes as the window could take */
+        uint64_t next_bytes = ((uint64_t)p_buffer[0] << 56) | ((uint64_t)p_buffer[1] << 48) | ((uint64_t)p_buffer[2] << 40) | ((uint64_t)p_buffer[3] << 32) |
+                              ((uint64_t)p_buffer[4] << 24) | ((uint64_t)p_buffer[5] << 16) | ((uint64_t)p_buffer[6] <<  8) |  (uint64_t)p_buffer[7];
+        int num_bytes = (64 - num_bits) >> 3;
+
+        p_aec->i_byte_buf   |= (next_bytes >> (64 - 8 * num_bytes)) << (64 - 8 * num_bytes - num_bits);
+        p_aec->i_byte_pos   += num_bytes;
+        p_aec->i_bits_to_go += 8 * num_bytes;
+    } else {
+        /* the end of the stream */
+        for (; num_left > 0 && num_bits <= 56; num_left--, num_bits += 8) {
+            p_aec->i_byte_buf |= (uint64_t)(*p_buffer++) << (56 - num_bits);
+            p_aec->i_byte_pos++;
         }
-        p_aec->i_bits_to_go += (diff << 3);
-        p_aec->i_byte_pos += (p_aec->i_bits_to_go + 1) >> 3;
+        p_aec->i_bits_to_go = num_bits;
+    }
+}
 
-        p_aec->i_byte_buf = 0;
-        for (i = 0; i < diff; i++) {
-            p_aec->i_byte_buf = (p_aec->i_byte_buf << 8) | p_buffer[i];
+/* ---------------------------------------------------------------------------
+ * shift the next num_bits bits (0 ~ 32) into i_value_t, return 1 on the end of the stream
+ */
+static ALWAYS_INLINE
+int aec_get_next_n_bit(aec_t *p_aec, int num_bits)
+{
+    if (p_aec->i_bits_to_go < num_bits) {
+        aec_refill(p_aec);
+
+        if (p_aec->i_bits_to_go < num_bits) {
+            /* take the bits left, i_bits_to_go turns negative */
+            int num_left = DAVS2_MAX(p_aec->i_bits_to_go, 0);
+
+            p_aec->i_value_t     = (p_aec->i_value_t << num_left) | (uint32_t)((p_aec->i_byte_buf >> 1) >> (63 - num_left));
+            p_aec->i_byte_buf    = 0;
+            p_aec->i_bits_to_go -= num_bits;
+            p_aec->b_bit_error   = 1;
+            return 1;
         }
-#endif
     }
 
-    /* get next bit */
-    next_bit = ((p_aec->i_byte_buf >> p_aec->i_bits_to_go) & 0x01);
-
-    p_aec->i_value_t = (p_aec->i_value_t << 1) | next_bit;
+    /* (buf >> 1) >> (63 - n): no shift by 64 when n is 0 */
+    p_aec->i_value_t     = (p_aec->i_value_t << num_bits) | (uint32_t)((p_aec->i_byte_buf >> 1) >> (63 - num_bits));
+    p_aec->i_byte_buf  <<= num_bits;
+    p_aec->i_bits_to_go -= num_bits;
 
     return 0;
 }
 
-
+/* ---------------------------------------------------------------------------
+ */
+static ALWAYS_INLINE
+int aec_get_next_bit(aec_t *p_aec)
+{
+    return aec_get_next_n_bit(p_aec, 1);
+}
 
 /* ---------------------------------------------------------------------------
+ * i_value_t is in R domain: read bits until it reaches QUARTER (at most
+ * AEC_VALUE_BOUND bits), the number of bits read is the new value_s.
+ * return 1 on the end of the stream
  */
 static ALWAYS_INLINE
-int aec_get_next_n_bit(aec_t *p_aec, int num_bits)
+int aec_norm_value(aec_t *p_aec, uint32_t *p_value_s)
 {
-    if (p_aec->i_bits_to_go >= num_bits) {
-        uint32_t next_bits;
-        p_aec->i_bits_to_go -= (int8_t)num_bits;
-        next_bits = (p_aec->i_byte_buf >> p_aec->i_bits_to_go) & ((1 << num_bits) - 1);
+    uint32_t value_s = 0;
 
-        p_aec->i_value_t = (p_aec->i_value_t << num_bits) | next_bits;
+    if (p_aec->i_value_t != 0) {
+        /* the MSB of i_value_t moves to bit 8 in one read */
+        int num_bits = davs2_clz(p_aec->i_value_t) - 23;
 
-        return 0;
+        if (num_bits > 0) {
+            if (aec_get_next_n_bit(p_aec, num_bits)) {
+                return 1;
+            }
+            value_s = num_bits;
+        }
     } else {
-        for (; num_bits != 0; num_bits--) {
-            aec_get_next_bit(p_aec);
+        /* leading zero bits in the stream (rare) */
+        while (p_aec->i_value_t < QUARTER && value_s < AEC_VALUE_BOUND) {
+            if (aec_get_next_bit(p_aec)) {
+                return 1;
+            }
+            value_s++;
         }
-        return p_aec->b_bit_error;
     }
+
+    *p_value_s         = value_s;
+    p_aec->b_val_bound = p_aec->i_value_t < QUARTER;
+    p_aec->i_value_t   = p_aec->i_value_t & 0xff;
+
+    return 0;
 }
-    
+
+/* ---------------------------------------------------------------------------
+ * LPS: move i_value_t to the LPS range and restore the range t_rlps, the bit
+ * of the next value_s (b_next_s) and the range bits are read at once.
+ * return the new i_t1, -1 on the end of the stream
+ */
+static ALWAYS_INLINE
+int aec_decode_lps(aec_t *p_aec, uint32_t t_rlps, uint32_t t2, int b_next_s)
+{
+    int num_bits = DAVS2_MAX(davs2_clz(t_rlps) - 23, 0);
+    uint32_t offset = (((uint32_t)b_next_s << 8) - t2) << num_bits;
+
+    if (aec_get_next_n_bit(p_aec, b_next_s + num_bits)) {
+        return -1;
+    }
+    p_aec->i_value_t += offset;
+
+    return (t_rlps << num_bits) & 0xff;
+}
+
 /**
  * ===========================================================================
  * function defines
@@ -245,7 +289,7 @@ static ALWAYS_INLINE
 void update_ctx_mps(context_t *ctx)
 {
 #if CTRL_OPT_AEC
-    ctx->v = g_tab_ctx_mps[ctx->v].v;
+    ctx->v = g_tab_ctx_next[2 * ctx->v].v;
 #else
     uint32_t lg_pmps = ctx->LG_PMPS;
     uint8_t  cycno   = (uint8_t)ctx->cycno; 
@@ -267,7 +311,7 @@ static ALWAYS_INLINE
 void update_ctx_lps(context_t *ctx)
 {
 #if CTRL_OPT_AEC
-    ctx->v = g_tab_ctx_lps[ctx->v].v;
+    ctx->v = g_tab_ctx_next[2 * ctx->v + 1].v;
 #else
     uint32_t cycno   = ctx->cycno;
     uint32_t cwr     = tab_cwr[cycno];
@@ -288,26 +332,42 @@ void update_ctx_lps(context_t *ctx)
 #endif
 }
 
+/* ---------------------------------------------------------------------------
+ * update the context after a symbol, without a branch on the table
+ */
+static ALWAYS_INLINE
+void update_ctx(context_t *ctx, int is_LPS)
+{
+#if CTRL_OPT_AEC
+    ctx->v = g_tab_ctx_next[2 * ctx->v + is_LPS].v;
+#else
+    if (is_LPS) {
+        update_ctx_lps(ctx);
+    } else {
+        update_ctx_mps(ctx);
+    }
+#endif
+}
+
 #if CTRL_OPT_AEC
 /* ---------------------------------------------------------------------------
+ * the parsers of several slices may start at the same time, the table is
+ * built once by the first one
  */
-void init_aec_context_tab(void)
+static davs2_thread_once_t g_aec_context_once = DAVS2_THREAD_ONCE_INIT;
+
+/* ---------------------------------------------------------------------------
+ */
+static void build_aec_context_tab(void)
 {
-    static bool_t b_inited = 0;
     context_t ctx_i;
     context_t ctx_o;
     int cycno;
     int mps;
 
-    if (b_inited != 0) {
-        return;
-    }
     /* init context table */
-    b_inited = 1;
     ctx_i.v = 0;
     ctx_o.v = 0;
-    memset(g_tab_ctx_mps, 0, sizeof(g_tab_ctx_mps));
-    memset(g_tab_ctx_lps, 0, sizeof(g_tab_ctx_lps));
 
     /* mps */
     for (cycno = 0; cycno < 4; cycno++) {
@@ -322,7 +382,7 @@ void init_aec_context_tab(void)
                 uint32_t lg_pmps = ctx_i.LG_PMPS;
                 lg_pmps -= (lg_pmps >> cwr) + (lg_pmps >> (cwr + 2));
                 ctx_o.LG_PMPS = (uint16_t)lg_pmps;
-                g_tab_ctx_mps[ctx_i.v].v = ctx_o.v;
+                g_tab_ctx_next[2 * ctx_i.v].v = ctx_o.v;
             }
         }
     }
@@ -343,11 +403,18 @@ void init_aec_context_tab(void)
                     ctx_o.MPS = !mps;
                 }
                 ctx_o.LG_PMPS = (uint16_t)lg_pmps;
-                g_tab_ctx_lps[ctx_i.v].v = ctx_o.v;
+                g_tab_ctx_next[2 * ctx_i.v + 1].v = ctx_o.v;
             }
         }
     }
 }
+
+/* ---------------------------------------------------------------------------
+ */
+void init_aec_context_tab(void)
+{
+    davs2_thread_once(&g_aec_context_once, build_aec_context_tab);
+}
 #endif
 
 /* ---------------------------------------------------------------------------
@@ -359,6 +426,7 @@ int aec_start_decoding(aec_t *p_aec, uint8_t *p_start, int i_byte_pos, int i_byt
     init_aec_context_tab();
 #endif
     p_aec->p_buffer         = p_start;
+    p_aec->i_byte_buf       = 0;
     p_aec->i_byte_pos       = i_byte_pos;
     p_aec->i_bytes          = i_bytes;
     p_aec->i_bits_to_go     = 0;
@@ -369,10 +437,8 @@ int aec_start_decoding(aec_t *p_aec, uint8_t *p_start, int i_byte_pos, int i_byt
     p_aec->i_value_s        = 0;
     p_aec->i_value_t        = 0;
 
-    if (p_aec->i_bits_to_go < B_BITS - 1) {
-        if (aec_get_next_n_bit(p_aec, B_BITS - 1)) {
-            return 0;
-        }
+    if (aec_get_next_n_bit(p_aec, B_BITS - 1)) {
+        return 0;
     }
 
     return 0;
@@ -400,18 +466,11 @@ int biari_decode_symbol(aec_t *p_aec, context_t *ctx)
 
     // p_aec->i_value_t is in R domain  p_aec->i_s1=0 or p_aec->i_s1 == AEC_VALUE_BOUND
     if (p_aec->b_val_domain != 0 || (p_aec->i_s1 == AEC_VALUE_BOUND && p_aec->b_val_bound != 0)) {
-        i_value_s   = 0;
         p_aec->i_s1 = 0;
 
-        while (p_aec->i_value_t < QUARTER && i_value_s < AEC_VALUE_BOUND) {
-            if (aec_get_next_bit(p_aec)) {
-                return 0;
-            }
-            i_value_s++;
+        if (aec_norm_value(p_aec, &i_value_s)) {
+            return 0;
         }
-
-        p_aec->b_val_bound = p_aec->i_value_t < QUARTER;
-        p_aec->i_value_t   = p_aec->i_value_t & 0xff;
     }
 
     if (p_aec->i_value_s > AEC_VALUE_BOUND) {
@@ -429,42 +488,24 @@ int biari_decode_symbol(aec_t *p_aec, context_t *ctx)
     p_aec->b_val_domain = (bool_t)is_LPS;
 
     if (is_LPS) {     // LPS
-        uint32_t t_rlps = (s_flag == 0) ? (lg_pmps) : (p_aec->i_t1 + lg_pmps);
-        int n_bits = 0;
-        bit = !bit;
-
-        if (s2 == i_value_s) {
-            p_aec->i_value_t -= t2;
-        } else {
-            if (aec_get_next_bit(p_aec)) {
-                return 0;
-            }
-            p_aec->i_value_t += 256 - t2;
-        }
+        int t1 = aec_decode_lps(p_aec, lg_pmps + (p_aec->i_t1 & (0 - s_flag)), t2, s2 != i_value_s);
 
-        // restore range
-        while (t_rlps < QUARTER) {
-            t_rlps <<= 1;
-            n_bits++;
-        }
-        if (n_bits) {
-            if (aec_get_next_n_bit(p_aec, n_bits)) {
-                return 0;
-            }
+        if (t1 < 0) {
+            return 0;
         }
 
         p_aec->i_s1 = 0;
-        p_aec->i_t1 = t_rlps & 0xff;
-        update_ctx_lps(ctx);
+        p_aec->i_t1 = t1;
     } else {        // MPS
         p_aec->i_s1 = s2;
         p_aec->i_t1 = t2;
-        update_ctx_mps(ctx);
     }
 
+    update_ctx(ctx, is_LPS);
+
     p_aec->i_value_s = i_value_s;
 
-    return bit;
+    return bit ^ is_LPS;
 }
 
 /* ---------------------------------------------------------------------------
@@ -494,15 +535,8 @@ int biari_decode_symbol_eq_prob(aec_t *p_aec)
         p_aec->b_val_domain = (bool_t)is_LPS;
 
         if (is_LPS) {    //LPS
-            if (s2 == p_aec->i_value_s) {
-                p_aec->i_value_t -= t2;
-            } else {
-                if (aec_get_next_bit(p_aec)) {
-                    return 0;
-                }
-                p_aec->i_value_t += 256 - t2;
-            }
-            return 1;
+            /* the range is kept: no bits to restore it */
+            return aec_decode_lps(p_aec, QUARTER, t2, s2 != p_aec->i_value_s) >= 0;
         } else {
             p_aec->i_s1 = s2;
             p_aec->i_t1 = t2;
@@ -511,6 +545,49 @@ int biari_decode_symbol_eq_prob(aec_t *p_aec)
     }
 }
 
+/* ---------------------------------------------------------------------------
+ * decode num_bins equiprobable symbols, the first one in the highest bit.
+ * in R domain each bin subtracts the range (256 + i_t1) from the doubled
+ * value when it could, that is a restoring division: up to 16 bins are
+ * worked out from a single read of the window
+ */
+static INLINE
+int biari_decode_bypass_bits(aec_t *p_aec, int num_bins)
+{
+    int bins = 0;
+
+    while (num_bins > 0) {
+        int n = DAVS2_MIN(num_bins, 16);
+        uint32_t range = 256 + p_aec->i_t1;
+
+        if (p_aec->b_val_domain != 0 && p_aec->i_value_t < range &&
+            (p_aec->i_bits_to_go >= n || (aec_refill(p_aec), p_aec->i_bits_to_go >= n))) {
+            uint32_t value;
+            int i;
+
+            aec_get_next_n_bit(p_aec, n);
+            value = p_aec->i_value_t;
+
+            for (i = n - 1; i >= 0; i--) {
+                uint32_t lps = 0 - (uint32_t)(value >= (range << i));
+
+                value -= (range << i) & lps;
+                bins   = (bins << 1) | (lps & 1);
+            }
+
+            p_aec->i_s1      = 0;
+            p_aec->i_value_t = value;
+            num_bins        -= n;
+        } else {
+            /* LG domain or the end of the stream: one bin */
+            bins = (bins << 1) | biari_decode_symbol_eq_prob(p_aec);
+            num_bins--;
+        }
+    }
+
+    return bins;
+}
+
 /* ---------------------------------------------------------------------------
  */
 static INLINE
@@ -526,17 +603,10 @@ int biari_decode_final(aec_t *p_aec)
     // p_aec->i_value_t is in R domain  p_aec->i_s1=0 or p_aec->i_s1 == AEC_VALUE_BOUND
     if (p_aec->b_val_domain != 0 || (p_aec->i_s1 == AEC_VALUE_BOUND && p_aec->b_val_bound != 0)) {
         p_aec->i_s1 = 0;
-        p_aec->i_value_s = 0;
 
-        while (p_aec->i_value_t < QUARTER && p_aec->i_value_s < AEC_VALUE_BOUND) {
-            if (aec_get_next_bit(p_aec)) {
-                return 0;
-            }
-            p_aec->i_value_s++;
+        if (aec_norm_value(p_aec, &p_aec->i_value_s)) {
+            return 0;
         }
-
-        p_aec->b_val_bound = p_aec->i_value_t < QUARTER;
-        p_aec->i_value_t = p_aec->i_value_t & 0xff;
     }
 
     s_flag = p_aec->i_t1 < lg_pmps;
@@ -548,27 +618,9 @@ int biari_decode_final(aec_t *p_aec)
     p_aec->b_val_domain = (bool_t)is_LPS;
 
     if (is_LPS) {     // LPS
-        uint32_t t_rlps = 1;
-        int n_bits = 0;
-
-        if (s2 == p_aec->i_value_s) {
-            p_aec->i_value_t -= t2;
-        } else {
-            if (aec_get_next_bit(p_aec)) {
-                return 0;
-            }
-            p_aec->i_value_t += 256 - t2;
-        }
-
-        // restore range
-        while (t_rlps < QUARTER) {
-            t_rlps <<= 1;
-            n_bits++;
-        }
-        if (n_bits) {
-            if (aec_get_next_n_bit(p_aec, n_bits)) {
-                return 0;
-            }
+        /* t_rlps is 1: 8 bits restore the range */
+        if (aec_decode_lps(p_aec, 1, t2, s2 != p_aec->i_value_s) < 0) {
+            return 0;
         }
 
         p_aec->i_s1 = 0;
@@ -606,17 +658,10 @@ int biari_decode_symbol_continue0(aec_t *p_aec, context_t *ctx, int max_num)
 
         if (p_aec->b_val_domain != 0 || (p_aec->i_s1 == AEC_VALUE_BOUND && p_aec->b_val_bound != 0)) {
             p_aec->i_s1 = 0;
-            i_value_s = 0;
 
-            while (p_aec->i_value_t < QUARTER && i_value_s < AEC_VALUE_BOUND) {
-                if (aec_get_next_bit(p_aec)) {
-                    return 0;
-                }
-                i_value_s++;
+            if (aec_norm_value(p_aec, &i_value_s)) {
+                return 0;
             }
-
-            p_aec->b_val_bound = p_aec->i_value_t < QUARTER;
-            p_aec->i_value_t = p_aec->i_value_t & 0xff;
         }
 
         s_flag = p_aec->i_t1 < lg_pmps;
@@ -633,38 +678,21 @@ int biari_decode_symbol_continue0(aec_t *p_aec, context_t *ctx, int max_num)
         p_aec->b_val_domain = (bool_t)is_LPS;
 
         if (is_LPS) {     // LPS
-            uint32_t t_rlps = (s_flag == 0) ? (lg_pmps) : (p_aec->i_t1 + lg_pmps);
-            int n_bits = 0;
-            bit = !bit;
+            int t1 = aec_decode_lps(p_aec, lg_pmps + (p_aec->i_t1 & (0 - s_flag)), t2, s2 != i_value_s);
 
-            if (s2 == i_value_s) {
-                p_aec->i_value_t -= t2;
-            } else {
-                if (aec_get_next_bit(p_aec)) {
-                    return 0;
-                }
-                p_aec->i_value_t += 256 - t2;
-            }
-
-            // restore range
-            while (t_rlps < QUARTER) {
-                t_rlps <<= 1;
-                n_bits++;
-            }
-            if (n_bits) {
-                if (aec_get_next_n_bit(p_aec, n_bits)) {
-                    return 0;
-                }
+            if (t1 < 0) {
+                return 0;
             }
 
+            bit = !bit;
             p_aec->i_s1 = 0;
-            p_aec->i_t1 = t_rlps & 0xff;
-            update_ctx_lps(ctx);
+            p_aec->i_t1 = t1;
         } else {        // MPS
             p_aec->i_s1 = s2;
             p_aec->i_t1 = t2;
-            update_ctx_mps(ctx);
         }
+
+        update_ctx(ctx, is_LPS);
     }
 
     p_aec->i_value_s = i_value_s;
@@ -686,23 +714,16 @@ int biari_decode_symbol_continu0_ext(aec_t *p_aec, context_t *ctx, int max_ctx_i
         uint32_t t2;
         uint32_t s2;
         int is_LPS;
-        int s_flag;
+        uint32_t s_flag;
 
         bit = p_ctx->MPS;
 
         if (p_aec->b_val_domain != 0 || (p_aec->i_s1 == AEC_VALUE_BOUND && p_aec->b_val_bound != 0)) {
             p_aec->i_s1 = 0;
-            p_aec->i_value_s = 0;
 
-            while (p_aec->i_value_t < QUARTER && p_aec->i_value_s < AEC_VALUE_BOUND) {
-                if (aec_get_next_bit(p_aec)) {
-                    return 0;
-                }
-                p_aec->i_value_s++;
+            if (aec_norm_value(p_aec, &p_aec->i_value_s)) {
+                return 0;
             }
-
-            p_aec->b_val_bound = p_aec->i_value_t < QUARTER;
-            p_aec->i_value_t = p_aec->i_value_t & 0xff;
         }
 
         s_flag = p_aec->i_t1 < lg_pmps;
@@ -720,35 +741,21 @@ int biari_decode_symbol_continu0_ext(aec_t *p_aec, context_t *ctx, int max_ctx_i
         p_aec->b_val_domain = (bool_t)is_LPS;
 
         if (is_LPS) {     // LPS
-            uint32_t t_rlps = (s_flag == 0) ? (lg_pmps) : (p_aec->i_t1 + lg_pmps);
-            bit = !bit;
+            int t1 = aec_decode_lps(p_aec, lg_pmps + (p_aec->i_t1 & (0 - s_flag)), t2, s2 != p_aec->i_value_s);
 
-            if (s2 == p_aec->i_value_s) {
-                p_aec->i_value_t -= t2;
-            } else {
-                if (aec_get_next_bit(p_aec)) {
-                    return 0;
-                }
-                p_aec->i_value_t += 256 - t2;
-            }
-
-            // restore range
-            while (t_rlps < QUARTER) {
-                t_rlps <<= 1;
-
-                if (aec_get_next_bit(p_aec)) {
-                    return 0;
-                }
+            if (t1 < 0) {
+                return 0;
             }
 
+            bit = !bit;
             p_aec->i_s1 = 0;
-            p_aec->i_t1 = t_rlps & 0xff;
-            update_ctx_lps(p_ctx);
+            p_aec->i_t1 = t1;
         } else {        // MPS
             p_aec->i_s1 = s2;
             p_aec->i_t1 = t2;
-            update_ctx_mps(p_ctx);
         }
+
+        update_ctx(p_ctx, is_LPS);
     }
 
     return i - bit;
@@ -818,9 +825,8 @@ int aec_read_dmh_mode(aec_t *p_aec, int i_cu_level)
                 /* 1,2ԪŴ1110x
                  * 5,6ԪŴ1111x
                  */
-                int b3 = biari_decode_symbol_eq_prob(p_aec);
-                int b4 = biari_decode_symbol_eq_prob(p_aec);
-                return 1 + (b3 << 2) + b4;
+                int b34 = biari_decode_bypass_bits(p_aec, 2);
+                return 1 + ((b34 >> 1) << 2) + (b34 & 1);
             }
         }
     }
@@ -859,12 +865,8 @@ int aec_read_mvd(aec_t *p_aec, context_t *p_ctx)
             }
         }
 
-        while (golomb_order--) {
-            // next binary part
-            if (biari_decode_symbol_eq_prob(p_aec)) {
-                binary_symbol |= (1 << golomb_order);
-            }
-        }
+        // next binary part
+        binary_symbol = biari_decode_bypass_bits(p_aec, golomb_order);
 
         act_sym += binary_symbol;
         act_sym = (act_sym << 1) + 3 + add_sym;
@@ -1855,102 +1857,44 @@ int get_abssum_of_n_last_coeffs(runlevel_pair_t *p_runlevel, int end_pair_pos, i
 }
 
 /* ---------------------------------------------------------------------------
+ * run parser, specialized per block class:
+ *   luma (non-DC/diag scan), luma (DC/diag scan) and chroma
  */
-typedef int (*aec_read_run_f)(aec_t *p_aec, context_t *p_ctx, int pos, int b_only_one_cg, int b_1st_cg);
-
-/* ---------------------------------------------------------------------------
- */
-static
-int aec_read_run_luma1(aec_t *p_aec, context_t *p_ctx, int pos, int b_only_one_cg, int b_1st_cg)
-{
-    int ctxpos;
-    int Run = 0;
-    int offset = 0;
-
-    b_only_one_cg = b_only_one_cg ? 0 : 4;
-
-    for (ctxpos = 0; Run != pos; ctxpos++) {
-        if (ctxpos < pos) {
-            int moddiv; // 012
-            moddiv = (tab_scan_4x4[pos - 1 - ctxpos][1] + 1) >> 1;
-            offset = (b_1st_cg ? (pos == ctxpos + 1 ? 0 : (1 + moddiv)) : (4 + moddiv)) + b_only_one_cg;  // 0,...,10
-        }
-
-        assert(offset >= 0 && offset < NUM_MAP_CTX);
-        if (biari_decode_symbol(p_aec, p_ctx + offset)) {
-            break;
-        }
-
-        Run++;
-    }
-
-    return Run;
-}
-
-/* ---------------------------------------------------------------------------
- */
-static
-int aec_read_run_luma2(aec_t *p_aec, context_t *p_ctx, int pos, int b_only_one_cg, int b_1st_cg)
-{
-    int ctxpos;
-    int Run = 0;
-    int offset = 0;
-
-    b_only_one_cg = b_only_one_cg ? 0 : 4;
-    
-    for (ctxpos = 0; Run != pos; ctxpos++) {
-        if (ctxpos < pos) {
-            int moddiv; // 012
-            moddiv = ((pos < ctxpos + 4) ? 0 : (pos < ctxpos + 11 ? 1 : 2));
-            offset = (b_1st_cg ? (pos == ctxpos + 1 ? 0 : (1 + moddiv)) : (4 + moddiv)) + b_only_one_cg;  // 0,...,10
-        }
-
-        assert(offset >= 0 && offset < NUM_MAP_CTX);
-        if (biari_decode_symbol(p_aec, p_ctx + offset)) {
-            break;
-        }
-
-        Run++;
-    }
-
-    return Run;
-}
-
-
-/* ---------------------------------------------------------------------------
- */
-static
-int aec_read_run_chroma(aec_t *p_aec, context_t *p_ctx, int pos, int b_only_one_cg, int b_1st_cg)
+template<int b_luma, int is_dc_diag, int b_only_one_cg>
+static ALWAYS_INLINE
+int aec_read_run(aec_t *p_aec, context_t *p_ctx, int pos, int b_1st_cg)
 {
-    int ctxpos;
-    int Run = 0;
-    int offset = 0;
-
-    b_only_one_cg = b_only_one_cg ? 0 : 3;
-
-    for (ctxpos = 0; Run != pos; ctxpos++) {
-        if (ctxpos < pos) {
-            int moddiv = (pos >= 6 + ctxpos);
-            offset = (b_1st_cg ? (pos == ctxpos + 1 ? 0 : (1 + moddiv)) : (3 + moddiv)) + b_only_one_cg;
+    const int ctx_cg = b_luma ? 4 : 3;          // first context of the non-first CGs
+    const int ctx_offset = b_only_one_cg ? 0 : ctx_cg;
+    int Run;
+
+    for (Run = 0; Run < pos; Run++) {
+        int moddiv; // 012
+        int offset;
+
+        if (!b_luma) {
+            moddiv = (pos >= 6 + Run);
+        } else if (!is_dc_diag) {
+            moddiv = (tab_scan_4x4[pos - 1 - Run][1] + 1) >> 1;
+        } else {
+            moddiv = ((pos < Run + 4) ? 0 : (pos < Run + 11 ? 1 : 2));
         }
+        offset = (b_1st_cg ? (pos == Run + 1 ? 0 : (1 + moddiv)) : (ctx_cg + moddiv)) + ctx_offset;
 
         assert(offset >= 0 && offset < NUM_MAP_CTX);
         if (biari_decode_symbol(p_aec, p_ctx + offset)) {
             break;
         }
-
-        Run++;
     }
 
     return Run;
 }
 
-
 /* ---------------------------------------------------------------------------
  */
+template<int b_luma, int is_dc_diag, int b_only_one_cg>
 static
-int aec_read_run_level(aec_t *p_aec, cu_t *p_cu, int num_cg, int b_luma, int is_dc_diag,
-                       runlevel_t *runlevel, int scale, int shift)
+int aec_read_run_level(aec_t *p_aec, cu_t *p_cu, int num_cg, runlevel_t *runlevel, int scale, int shift)
 {
     static const int numOfCoeffInCG = 16;
     const int add = (1 << (shift - 1));
@@ -1963,11 +1907,12 @@ int aec_read_run_level(aec_t *p_aec, cu_t *p_cu, int num_cg, int b_luma, int is_
     context_t *p_ctx_last_cg_pos           = runlevel->p_ctx_last_cg;
     context_t *p_ctx_last_pos_in_cg        = runlevel->p_ctx_last_pos_in_cg;
     runlevel_pair_t *p_runlevel            = runlevel->run_level;
+    const int b_swap_xy                    = runlevel->b_swap_xy;
+    const int i_coeff                      = runlevel->i_res;
     int idx_cg;
     int cg_pos = 0;
     int CGx = 0;
     int CGy = 0;
-    int b_only_one_cg = (num_cg == 1);
     int8_t dct_pattern = DCT_QUAD;
     int w_tr_half, w_tr_quad; // CG position limitation
     int h_tr_half, h_tr_quad; // CG position limitation
@@ -1977,7 +1922,6 @@ int aec_read_run_level(aec_t *p_aec, cu_t *p_cu, int num_cg, int b_luma, int is_
     int idx_runlevel = 0;
 #endif
     int rank = 0;
-    aec_read_run_f f_read_run = b_luma ? (!is_dc_diag ? aec_read_run_luma1 : aec_read_run_luma2) : aec_read_run_chroma;
 
     /* dct_pattern_e */
     if (w_tr == h_tr) {
@@ -2003,7 +1947,7 @@ int aec_read_run_level(aec_t *p_aec, cu_t *p_cu, int num_cg, int b_luma, int is_
     h_tr_quad >>= 2;
 
     /* 1, read last CG position */
-    if (num_cg > 1) {
+    if (!b_only_one_cg) {
         int num_cg_x_minus1 = tab_cg_scan[num_cg - 1][0];
         int num_cg_y_minus1 = tab_cg_scan[num_cg - 1][1];
         cg_pos = aec_read_last_cg_pos(p_aec, p_ctx_last_cg_pos, p_cu, &CGx, &CGy, b_luma, num_cg, is_dc_diag, num_cg_x_minus1, num_cg_y_minus1);
@@ -2056,11 +2000,8 @@ int aec_read_run_level(aec_t *p_aec, cu_t *p_cu, int num_cg, int b_luma, int is_
                         golomb_order++;
                     }
 
-                    while (golomb_order--) {
-                        // next binary part
-                        int sig = biari_decode_symbol_eq_prob(p_aec);
-                        binary_symbol |= (sig << golomb_order);
-                    }
+                    // next binary part
+                    binary_symbol = biari_decode_bypass_bits(p_aec, golomb_order);
 
                     Level += binary_symbol;
                     Level += 32;
@@ -2078,10 +2019,7 @@ int aec_read_run_level(aec_t *p_aec, cu_t *p_cu, int num_cg, int b_luma, int is_
                 p_ctx = ctxa_run[DAVS2_MIN(absSum5, 2)];
 
                 // run
-                Run = 0;
-                if (pos > 0) {
-                    Run = f_read_run(p_aec, p_ctx, pos, b_only_one_cg, b_1st_cg);
-                }
+                Run = aec_read_run<b_luma, is_dc_diag, b_only_one_cg>(p_aec, p_ctx, pos, b_1st_cg);
                 AEC_RETURN_ON_ERROR(-1);
 
 #if AVS2_TRACE
@@ -2108,44 +2046,39 @@ int aec_read_run_level(aec_t *p_aec, cu_t *p_cu, int num_cg, int b_luma, int is_
                 pos -= (Run + 1);
             } // for (i = -numOfCoeffInCG; i != 0; i++)
 
-            // sign of level
-            for (i = 0; i < num_pairs_in_cg; i++) {
-                if (biari_decode_symbol_eq_prob(p_aec)) {
-                    p_runlevel[i].level = -p_runlevel[i].level;
-                }
-            }
-
-            /* convert run-level to coefficients */
+            /* signs, dequantization and scatter of the run-level pairs into the CG */
             {
-                const int b_swap_xy  = runlevel->b_swap_xy;
-                const int i_coeff    = runlevel->i_res;
+                int signs = biari_decode_bypass_bits(p_aec, num_pairs_in_cg);
                 coeff_t *p_res = runlevel->p_res;
-                int num_pairs  = num_pairs_in_cg;
-                int coef_ctr   = -1;
+                int coef_ctr = -1;
+
                 if (b_swap_xy) {
-                    DAVS2_SWAP(CGx, CGy);
+                    p_res += i_coeff * (CGx << 2) + (CGy << 2);
+                } else {
+                    p_res += i_coeff * (CGy << 2) + (CGx << 2);
                 }
-                p_res += i_coeff * (CGy << 2) + (CGx << 2);
-                // RunLevelתCGڵķϵ
-                while (num_pairs > 0) {  /* leave if len=1 */
+
+                // RunLevelתCGڵķϵ, the sign of the last pair is the LSB of signs
+                for (i = num_pairs_in_cg - 1; i >= 0; i--, signs >>= 1) {
+                    int level = p_runlevel[i].level;
                     int x_in_cg, y_in_cg;
 
-                    int level = p_runlevel[num_pairs - 1].level;
-                    int run   = p_runlevel[num_pairs - 1].run;
-                    num_pairs--;
-                    if (run < 0 || run >= 16) {
-                        // davs2_log(h, DAVS2_LOG_ERROR, "wrong run level.");
+                    coef_ctr += p_runlevel[i].run + 1;
+                    if (coef_ctr >= 16) {
                         return -1;
                     }
-                    coef_ctr += run + 1;
 
                     x_in_cg = tab_scan_4x4[coef_ctr][ b_swap_xy];
                     y_in_cg = tab_scan_4x4[coef_ctr][!b_swap_xy];
 
+                    level = (signs & 1) ? -level : level;
                     level = (level * scale + add) >> shift;
                     p_res[y_in_cg * i_coeff + x_in_cg] = (coeff_t)DAVS2_CLIP3(-32768, 32767, level);
                 }
 
+                if (b_swap_xy) {
+                    DAVS2_SWAP(CGx, CGy);
+                }
                 if (CGy >= h_tr_half || CGx >= w_tr_half) {
                     dct_pattern = DCT_DEAULT;
                 } else if ((CGy >= h_tr_quad || CGx >= w_tr_quad) && dct_pattern != DCT_DEAULT) {
@@ -2159,6 +2092,21 @@ int aec_read_run_level(aec_t *p_aec, cu_t *p_cu, int num_cg, int b_luma, int is_
     return dct_pattern;
 }
 
+/* ---------------------------------------------------------------------------
+ * run-level parsers, indexed by [b_luma][is_dc_diag][b_only_one_cg]
+ */
+typedef int (*aec_read_run_level_f)(aec_t *p_aec, cu_t *p_cu, int num_cg, runlevel_t *runlevel, int scale, int shift);
+
+static const aec_read_run_level_f tab_read_run_level[2][2][2] = {
+    {
+        { aec_read_run_level<0, 0, 0>, aec_read_run_level<0, 0, 1> },
+        { aec_read_run_level<0, 1, 0>, aec_read_run_level<0, 1, 1> },
+    }, {
+        { aec_read_run_level<1, 0, 0>, aec_read_run_level<1, 0, 1> },
+        { aec_read_run_level<1, 1, 0>, aec_read_run_level<1, 1, 1> },
+    }
+};
+
 /* ---------------------------------------------------------------------------
  * get coefficients of one block
  */
@@ -2170,6 +2118,7 @@ int8_t cu_get_block_coeffs(aec_t *p_aec, runlevel_t *runlevel,
 {
     int num_coeffs = w_tr * h_tr;
     int num_cg = num_coeffs >> 4;
+    int is_dc_diag = (intra_pred_class == INTRA_PRED_DC_DIAG);
 
     runlevel->p_res         = p_res;
     runlevel->i_res         = w_tr;
@@ -2179,7 +2128,7 @@ int8_t cu_get_block_coeffs(aec_t *p_aec, runlevel_t *runlevel,
     runlevel->h_tr          = h_tr;
     UNUSED_PARAMETER(wq_size_id);
 
-    return (int8_t)aec_read_run_level(p_aec, p_cu, num_cg, b_luma, intra_pred_class == INTRA_PRED_DC_DIAG, runlevel, scale, shift);
+    return (int8_t)tab_read_run_level[b_luma != 0][is_dc_diag][num_cg == 1](p_aec, p_cu, num_cg, runlevel, scale, shift);
 }
 
 /* ---------------------------------------------------------------------------
@@ -2374,21 +2323,17 @@ static ALWAYS_INLINE int read_sao_type(aec_t *p_aec, int act_ctx)
 
         } while (temp != 1);
 
-        rest = 0;
-        while (golomb_order--) {
-            // next binary part
-            temp = biari_decode_symbol_eq_prob(p_aec);
-            if (temp == 1) {
-                rest |= (temp << golomb_order);
-            }
-        }
+        // next binary part
+        rest = biari_decode_bypass_bits(p_aec, golomb_order);
 
         act_sym += rest;
     } else {
+        /* the first bin is the LSB */
+        int bins = biari_decode_bypass_bits(p_aec, length);
         int i;
 
         for (i = 0; i < length; i++) {
-            act_sym = act_sym + (biari_decode_symbol_eq_prob(p_aec) << i);
+            act_sym |= ((bins >> (length - 1 - i)) & 1) << i;
         }
     }
 
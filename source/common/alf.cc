@@ -421,7 +421,7 @@ void alf_read_param(davs2_t *h, davs2_bs_t *bs)
 /* ---------------------------------------------------------------------------
  * ALF one LCU block
  */
-static void alf_lcu_block(davs2_t *h, alf_param_t *p_alf_param, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int i_lcu_x, int i_lcu_y)
+void alf_lcu_block(davs2_t *h, alf_param_t *p_alf_param, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int i_lcu_x, int i_lcu_y)
 {
     int lcu_size      = h->i_lcu_size;
     int img_height    = h->i_height;
@@ -41,6 +41,8 @@ size_t alf_get_buffer_size(davs2_t *h);
 #define alf_init_buffer FPFX(alf_init_buffer)
 void alf_init_buffer    (davs2_t *h);
 
+#define alf_lcu_block FPFX(alf_lcu_block)
+void alf_lcu_block(davs2_t *h, alf_param_t *p_alf_param, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int i_lcu_x, int i_lcu_y);
 #define alf_lcurow FPFX(alf_lcurow)
 void alf_lcurow(davs2_t *h, alf_param_t *p_alf_param, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int i_lcu_y);
 
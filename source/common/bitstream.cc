@@ -85,6 +85,9 @@ int found_slice_header(davs2_bs_t *bs)
 
     for (; num_bytes; num_bytes--) {
         uint8_t *data = bs->p_stream + ((bs->i_bit_pos + 7) >> 3);
+        if (bs->i_stream - ((bs->i_bit_pos + 7) >> 3) < 4) {
+            break;              /* do not read beyond the end of the buffer */
+        }
         uint32_t code = *(uint32_t *)data;
         if ((code & 0x00FFFFFF) == 0x00010000 && ((code >> 24) <= SC_SLICE_CODE_MAX)) {
             return 1;
@@ -51,9 +51,9 @@
  * ===========================================================================
  */
 #if HIGH_BIT_DEPTH
-int max_pel_value = 255;
-int g_bit_depth   = 8;
-int g_dc_value    = 128;
+DAVS2_THREAD_LOCAL int max_pel_value = 255;
+DAVS2_THREAD_LOCAL int g_bit_depth   = 8;
+DAVS2_THREAD_LOCAL int g_dc_value    = 128;
 #endif
 
 
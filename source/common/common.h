@@ -489,10 +489,17 @@ typedef union context_t {
 /* ---------------------------------------------------------------------------
  * syntax context management */
 typedef struct context_set_t {
+    /* the contexts of most bins first, a few cache lines for the transform
+     * coefficients and the CU splits */
+    context_t coeff_run             [2][NUM_BLOCK_TYPES][NUM_MAP_CTX];
+    context_t coeff_level              [NUM_COEFF_LEVEL_CTX];
+    context_t sig_cg_contexts          [NUM_SIGCG_CTX];
+    context_t cu_split_flag            [NUM_SPLIT_CTX];
+    context_t last_cg_contexts         [NUM_LAST_CG_CTX];
+    context_t last_coeff_pos           [NUM_LAST_POS_CTX];
     /* CU */
     context_t cu_type_contexts         [NUM_CUTYPE_CTX];
     context_t intra_pu_type_contexts   [NUM_INTRA_PU_TYPE_CTX];
-    context_t cu_split_flag            [NUM_SPLIT_CTX];
     context_t transform_split_flag     [NUM_TU_SPLIT_CTX];
     context_t shape_of_partition_index [NUM_AMP_CTX];
     context_t pu_reference_index       [NUM_REF_NO_CTX];
@@ -507,12 +514,6 @@ typedef struct context_set_t {
     /* ֡Ԥ */
     context_t intra_luma_pred_mode     [NUM_INTRA_MODE_CTX];
     context_t intra_chroma_pred_mode   [NUM_C_INTRA_MODE_CTX];
-    /* 任ϵ */
-    context_t coeff_run             [2][NUM_BLOCK_TYPES][NUM_MAP_CTX];
-    context_t coeff_level              [NUM_COEFF_LEVEL_CTX];
-    context_t last_cg_contexts         [NUM_LAST_CG_CTX];
-    context_t sig_cg_contexts          [NUM_SIGCG_CTX];
-    context_t last_coeff_pos           [NUM_LAST_POS_CTX];
     /*  */
     context_t sao_mergeflag_context    [NUM_SAO_MERGE_FLAG_CTX];
     context_t sao_mode_context         [NUM_SAO_MODE_CTX];
@@ -617,10 +618,10 @@ typedef struct neighbor_inter_t {
  */
 typedef struct aec_t {
     ALIGN32(uint8_t *p_buffer);
-    uint64_t    i_byte_buf;
+    uint64_t    i_byte_buf;           /* bit window, the next bit of the stream is the MSB */
     int         i_byte_pos;
     int         i_bytes;
-    int8_t      i_bits_to_go;
+    int         i_bits_to_go;         /* bits in i_byte_buf, negative after the end of the stream */
     bool_t      b_bit_error;          /* bit error in stream */
     bool_t      b_val_bound;
     bool_t      b_val_domain;         // is value in R domain 1 is R domain 0 is LG domain
@@ -630,7 +631,7 @@ typedef struct aec_t {
     uint32_t    i_value_t;
 
     /* context */
-    context_set_t   syn_ctx;              // pointer to struct of context models
+    ALIGN32(context_set_t syn_ctx);       // context models, the hot ones start a cache line
 #if AVS2_TRACE
     /* ---------------------------------------------------------------------------
      * syntax element */
@@ -706,6 +707,7 @@ typedef struct davs2_frame_t {
     int         i_poc;                /* POC (picture order count), used for MV scaling */
     int         i_coi;                /* COI (coding order index) */
     int         b_refered_by_others;  /* referenced by others */
+    int         i_job_priority;       /* priority of the decoding jobs (davs2_job_priority_e) */
 
     /* planes */
     int         i_plane;              /* number of planes */
@@ -723,10 +725,12 @@ typedef struct davs2_frame_t {
     int          is_self_malloc;      /* is the buffer allocated by itself */
     volatile int i_decoded_line;      /* latest lcu line that finished reconstruction */
     volatile int i_parsed_lcu_xy;     /* parsed number of LCU */
+    volatile int i_parsed_lcu_waited; /* smallest i_parsed_lcu_xy a sleeping thread waits for */
     int          i_conds;             /* number conds */
     davs2_thread_cond_t   cond_aec;   /* signal of AEC decoding */
     davs2_thread_cond_t  *conds_lcu_row;  /* [LCU lines] */
-    int *num_decoded_lcu_in_row;      /* number of LCUs decoded in a row */ 
+    volatile int *num_decoded_lcu_in_row; /* decoding status of each LCU row, see LCU_ROW_FINISHED */
+    volatile int *num_waited_lcu_in_row;  /* smallest number a sleeping thread waits for in a row */
     davs2_thread_mutex_t mutex_frm;   /* the mutex */
     davs2_thread_mutex_t mutex_recon; /* mutex of reconstruction threads */
 
@@ -734,6 +738,8 @@ typedef struct davs2_frame_t {
     pel_t      *planes[3];            /* pointers to Y/U/V data buffer */
     int8_t     *refbuf;               /* pointers to reference index buffer */
     mv_t       *mvbuf;                /* pointers to motion vector buffer*/
+    davs2_frame_buffer_t ext_buf;     /* planes buffer supplied by the application */
+    davs2_param_t       *ext_param;   /* allocator of the planes buffer, NULL for internal planes */
 } davs2_frame_t;
 
 
@@ -794,9 +800,6 @@ typedef struct lcu_rec_info_t {
 /* ---------------------------------------------------------------------------
  * LCU info */
 typedef struct lcu_info_t {
-#if CTRL_AEC_THREAD
-    lcu_rec_info_t rec_info;
-#endif
     sao_t      sao_param;                        /* SAO param for each LCU */
     uint8_t    enable_alf[IMG_COMPONENTS];       /* ALF enabled for each LCU */
 } lcu_info_t;
@@ -807,11 +810,11 @@ typedef struct lcu_info_t {
 struct cu_t {
     /* -------------------------------------------------------------
      * variables needed for neighboring CU decoding */
+    int8_t      i_slice_nr;           /* first, not copied by cu_read_end() */
+
     int8_t      i_cu_level;
     int8_t      i_cu_type;
 
-    int8_t      i_slice_nr;
-
     int8_t      i_qp;
     int8_t      i_cbp;
     int8_t      i_trans_size;         /* tu_split_type_e */
@@ -864,6 +867,9 @@ typedef struct davs2_output_t {
     int               output;         /* output index of the next frame */
     int               busy;           /* whether possibly one frame is being delivered */
     int               num_output_pic; /* number of pictures to be output */
+    int               num_inserted;   /* number of pictures put into the list so far */
+    int               num_skipped;    /* number of POCs in skipped[] */
+    int               skipped[AVS2_GOP_NUM]; /* POCs of the pictures dropped in catch-up mode, passed by the output */
     davs2_outpic_t  *pics;           /* output pictures */
 } davs2_output_t;
 
@@ -877,8 +883,12 @@ typedef struct es_unit_t {
     davs2_bs_t    bs;                 /* bit-stream reader of this es_unit */
     int64_t       pts;                /* presentation time stamp */
     int64_t       dts;                /* decoding time stamp */
+    int           flags;              /* packet flags, davs2_packet_flag_e */
     int           len;                /* length of valid data in byte stream buffer */
     int           size;               /* buffer size */
+    uint8_t      *borrowed;           /* byte stream lent by the application, used instead of 'data' */
+    davs2_packet_release_t release;   /* callback to give back the borrowed byte stream */
+    void         *release_opaque;     /* user data of the callback */
     uint8_t       data[1];            /* byte stream buffer */
 } es_unit_t;
 
@@ -900,6 +910,22 @@ struct davs2_log_t {
     char        module_name[60];      /* module name */
 };
 
+/* ---------------------------------------------------------------------------
+ * set of logical CPUs (thread affinity)
+ */
+typedef struct davs2_cpu_set_t {
+    uint64_t    bits[DAVS2_MAX_CPUS / 64];  /* bit i: CPU i */
+    int         num_cpus;             /* number of CPUs in the set, 0: empty */
+} davs2_cpu_set_t;
+
+/* ---------------------------------------------------------------------------
+ * memory policy of a thread, saved while its allocations are placed on a NUMA node
+ */
+typedef struct davs2_mem_policy_t {
+    int             mode;
+    unsigned long   nodes[DAVS2_MAX_NODES / (8 * sizeof(unsigned long))];
+} davs2_mem_policy_t;
+
 /* ---------------------------------------------------------------------------
  * decoder manager
  */
@@ -919,6 +945,11 @@ struct davs2_mgr_t {
     /* --- decoder output --------- */
     int                 new_sps;      /* is SPS(sequence property set) changed? */
     int                 num_frames_to_output;
+    davs2_frame_callback_t frame_callback;  /* deliver frames by callback when set */
+    void               *frame_callback_opaque;
+    davs2_rows_callback_t rows_callback;    /* report the final lines of decoding frames when set */
+    void               *rows_callback_opaque;
+    volatile int        b_catch_up;   /* drop the pictures no other picture references (catch-up mode) */
 
     /* --- decoding picture buffer (DBP) --------- */
     davs2_frame_t     **dpb;          /* decoded picture buffer array */
@@ -938,6 +969,8 @@ struct davs2_mgr_t {
     int                 num_decoders;        /* number of decoders in total */
     int                 num_active_decoders; /* number of active decoders currently */
     davs2_t            *decoders;            /* frame decoder contexts */
+    davs2_t           **free_tasks;          /* stack of free frame decoders (with mutex_mgr locked) */
+    int                 num_free_tasks;      /* number of free frame decoders */
     davs2_t            *h_dec;               /* decoder context for current input bitstream */
     int                 num_frames_in;       /* number of frames: input */
     int                 num_frames_out;      /* number of frames: output */
@@ -945,13 +978,49 @@ struct davs2_mgr_t {
     /* --- thread control ------------------------------------------ */
     int                     num_total_thread;  /* number of decoding threads in total */
     int                     num_aec_thread;    /* number of threads for AEC coding (the others are for reconstruction) */
-    int                     num_rec_thread;    /* use thread pool or not */
+    int                     num_rec_thread;    /* number of threads for reconstruction (pipeline), 0: none */
+    int                     num_flt_thread;    /* number of threads for the in-loop filters (pipeline), 0: none */
+    int                     num_frames_max;    /* frames parsed in parallel, the other threads reconstruct rows (adaptive) */
+    int                     num_frames_parsing;/* frames being parsed (with mutex_mgr locked) */
+    int                     num_frames_split;  /* frames parsed since the last adjustment of num_frames_max */
+    volatile int            wait_ref_us;       /* time the parsers waited for reference rows (pipeline) */
+    volatile int            wait_parse_us;     /* time the reconstruction waited for the parsers (pipeline) */
     davs2_thread_t          thread_output;     /* handle of the frame output thread */
     davs2_thread_mutex_t    mutex_mgr;         /* a non-recursive mutex */
-    davs2_thread_mutex_t    mutex_aec;         /* a non-recursive mutex for AEC */
+    davs2_thread_mutex_t    mutex_output;      /* serializes frames delivered by the callback */
+    davs2_thread_cond_t     cond_output;       /* signaled when a frame is put into the output list */
+    davs2_thread_cond_t     cond_task;         /* signaled when a frame decoder becomes free */
     void                   *thread_pool;       /* AEC encoding thread */ 
+    void                   *rec_pool;          /* reconstruction threads of the pipeline */
+    void                   *flt_pool;          /* in-loop filter threads of the pipeline, NULL: filtered by the reconstruction */
+    volatile int            num_slice_jobs;    /* slice parsing jobs queued or running (slice-parallel parsing) */
+    davs2_cpu_set_t         cpu_set;           /* CPUs the threads of the decoder are bound to, empty: not bound */
+    int                     i_mem_node;        /* NUMA node the buffers of the decoder are allocated on, -1: any */
 };
 
+/* ---------------------------------------------------------------------------
+ * slice of a picture (slice-parallel parsing)
+ */
+typedef struct davs2_slice_t {
+    int         i_start;              /* byte position of the start code in the picture data */
+    int         i_lcu_y;              /* first LCU row */
+    int         i_lcu_y_end;          /* LCU row after the last one */
+    int         b_parsed;             /* all LCUs parsed (with mutex locked) */
+} davs2_slice_t;
+
+/* ---------------------------------------------------------------------------
+ * slices of the picture being parsed in parallel
+ */
+typedef struct davs2_slices_t {
+    davs2_thread_mutex_t mutex;       /* serializes the end of the slices */
+    volatile int  i_frontier;         /* first slice not parsed completely, the only one reporting its progress */
+    volatile int  wait_ref_us;        /* time the parsers of the slices waited for reference rows */
+    int           num_slices;         /* number of slices of the picture */
+    int           num_decs;           /* number of parsing contexts of the slice jobs */
+    davs2_t      *decs;               /* parsing contexts of the slice jobs */
+    davs2_slice_t *slices;            /* slices of the picture, one LCU row at least each */
+} davs2_slices_t;
+
 /* ---------------------------------------------------------------------------
  */
 typedef struct davs2_row_rec_t {
@@ -1085,6 +1154,7 @@ struct davs2_t {
     bool_t      b_slice_checked;      /* is slice checked? */
     bool_t      b_fixed_slice_qp;
     int         i_slice_index;        /* current slice index */
+    int         i_slice_spu_y;        /* first SPU row of the current slice */
     int         i_slice_qp;
     int         i_last_dquant;
     pel_t      *intra_border[3];      /* buffer for store decoded bottom pixels of the top lcu row (before filter) */
@@ -1102,6 +1172,18 @@ struct davs2_t {
     davs2_frame_t *p_frame_alf;      /* used for ALF */
     lcu_info_t *lcu_infos;            /* LCU level info */
 
+    /* parse/reconstruction pipeline */
+    lcu_rec_info_t *rec_ring;         /* coefficients of the LCUs parsed and not yet reconstructed, NULL: no pipeline */
+    int         num_rec_ring;         /* number of LCUs in the ring */
+    volatile int num_rec_rows_left;   /* LCU rows whose reconstruction jobs have not finished */
+    int         b_rec_no_data;        /* no picture data, the reconstruction only finishes the frame */
+    volatile int num_flt_rows_ready;  /* LCU rows reconstructed and not yet filtered (filter threads) */
+    int         i_flt_lcu_y;          /* next LCU row to be filtered (filter threads) */
+    davs2_slices_t *p_slices;         /* slice-parallel parsing, NULL: the slices are parsed in order */
+    int         i_slice_job;          /* slice parsed by this context in parallel, -1: parsed in order */
+    volatile int slice_claim;         /* generation of the picture, number of slices and next slice to be
+                                       * parsed (slice-parallel parsing), kept when the buffers are reallocated */
+
     /* -------------------------------------------------------------
      * post processing */
 
@@ -1176,9 +1258,8 @@ struct davs2_t {
         mv_t    mv_tskip_1st[DS_MAX_NUM];
         mv_t    mv_tskip_2nd[DS_MAX_NUM];
 
-#if !CTRL_AEC_THREAD
+        lcu_rec_info_t     *p_rec_aec;        /* coefficients of the LCU being parsed */
         lcu_rec_info_t      rec_info;
-#endif
         ALIGN32(runlevel_t  cg_info);
 
     } lcu;
@@ -1194,9 +1275,10 @@ struct davs2_t {
  * ===========================================================================
  */
 #if HIGH_BIT_DEPTH
-extern int max_pel_value;
-extern int g_bit_depth;
-extern int g_dc_value;
+/* bit depth of the stream being decoded by the calling thread (see davs2_set_thread_bit_depth()) */
+extern DAVS2_THREAD_LOCAL int max_pel_value;
+extern DAVS2_THREAD_LOCAL int g_bit_depth;
+extern DAVS2_THREAD_LOCAL int g_dc_value;
 #else
 static const int g_bit_depth   = BIT_DEPTH;
 static const int max_pel_value = (1 << BIT_DEPTH) - 1;
@@ -1353,6 +1435,20 @@ static ALWAYS_INLINE pel_t davs2_clip_pixel(int x)
     return (pel_t)((x & ~max_pel_value) ? (-x) >> 31 & max_pel_value : x);
 }
 
+/* ---------------------------------------------------------------------------
+ * set the bit depth used by the pixel functions in the calling thread,
+ * must be called before a thread works on a picture of another stream */
+static ALWAYS_INLINE void davs2_set_thread_bit_depth(int bit_depth)
+{
+#if HIGH_BIT_DEPTH
+    g_bit_depth   = bit_depth;
+    max_pel_value = (1 << bit_depth) - 1;
+    g_dc_value    = 1 << (bit_depth - 1);
+#else
+    UNUSED_PARAMETER(bit_depth);
+#endif
+}
+
 static ALWAYS_INLINE int davs2_clip3(int v, int i_min, int i_max)
 {
     return ((v < i_min) ? i_min : (v > i_max) ? i_max : v);
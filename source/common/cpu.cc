@@ -384,6 +384,14 @@ uint32_t davs2_cpu_detect(void)
 int sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t *mask);
 #endif
 
+#if SYS_LINUX
+#include <sys/syscall.h>
+#if defined(SYS_get_mempolicy) && defined(SYS_set_mempolicy)
+#define HAVE_MEMPOLICY      1
+#define DAVS2_MPOL_PREFERRED 1         /* MPOL_PREFERRED of <numaif.h>, without linking libnuma */
+#endif
+#endif
+
 /* ---------------------------------------------------------------------------
  */
 int davs2_cpu_num_processors(void)
@@ -430,3 +438,189 @@ int davs2_cpu_num_processors(void)
     return 1;
 #endif
 }
+
+/* ---------------------------------------------------------------------------
+ * add a CPU to a set
+ */
+static void cpu_set_add(davs2_cpu_set_t *set, int cpu)
+{
+    uint64_t bit = (uint64_t)1 << (cpu & 63);
+
+    if ((set->bits[cpu >> 6] & bit) == 0) {
+        set->bits[cpu >> 6] |= bit;
+        set->num_cpus++;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * parse a list of logical CPUs such as "0-7,16,18", return 0 for a valid non-empty set
+ */
+int davs2_cpu_set_parse(davs2_cpu_set_t *set, const char *cpu_list)
+{
+    const char *p = cpu_list;
+
+    memset(set, 0, sizeof(davs2_cpu_set_t));
+    while (*p != '\0' && *p != '\n') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last  = first;
+
+        if (end == p) {
+            return -1;
+        }
+        p = end;
+        if (*p == '-') {
+            last = strtol(++p, &end, 10);
+            if (end == p) {
+                return -1;
+            }
+            p = end;
+        }
+        if (first < 0 || last < first || last >= DAVS2_MAX_CPUS) {
+            return -1;
+        }
+        for (; first <= last; first++) {
+            cpu_set_add(set, (int)first);
+        }
+
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0' && *p != '\n') {
+            return -1;
+        }
+    }
+
+    return set->num_cpus > 0 ? 0 : -1;
+}
+
+/* ---------------------------------------------------------------------------
+ * get the logical CPUs of a NUMA node, return 0 on success
+ */
+int davs2_cpu_set_numa_node(davs2_cpu_set_t *set, int node)
+{
+#if SYS_LINUX
+    char path[64];
+    char cpu_list[1024];
+    FILE *fp;
+    int ret = -1;
+
+    memset(set, 0, sizeof(davs2_cpu_set_t));
+    sprintf(path, "/sys/devices/system/node/node%d/cpulist", node);
+    if (node >= 0 && (fp = fopen(path, "r")) != NULL) {
+        if (fgets(cpu_list, sizeof(cpu_list), fp) != NULL) {
+            ret = davs2_cpu_set_parse(set, cpu_list);
+        }
+        fclose(fp);
+    }
+    return ret;
+#elif SYS_WINDOWS
+    ULONGLONG mask = 0;
+    int i;
+
+    memset(set, 0, sizeof(davs2_cpu_set_t));
+    if (node < 0 || node > 255 || !GetNumaNodeProcessorMask((UCHAR)node, &mask)) {
+        return -1;
+    }
+    for (i = 0; i < 64; i++) {
+        if ((mask >> i) & 1) {
+            cpu_set_add(set, i);
+        }
+    }
+    return set->num_cpus > 0 ? 0 : -1;
+#else
+    UNUSED_PARAMETER(node);
+    memset(set, 0, sizeof(davs2_cpu_set_t));
+    return -1;
+#endif
+}
+
+/* ---------------------------------------------------------------------------
+ * bind the calling thread to a set of CPUs, return 0 on success
+ */
+int davs2_cpu_set_affinity(const davs2_cpu_set_t *set)
+{
+#if HAVE_THREAD && SYS_LINUX && !(defined(__ARM_ARCH_7A__) || defined(__ARM_ARCH_7__))
+    cpu_set_t p_aff;
+    int i;
+
+    CPU_ZERO(&p_aff);
+    for (i = 0; i < DAVS2_MAX_CPUS && i < CPU_SETSIZE; i++) {
+        if ((set->bits[i >> 6] >> (i & 63)) & 1) {
+            CPU_SET(i, &p_aff);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(p_aff), &p_aff) != 0 ? -1 : 0;
+#elif HAVE_THREAD && SYS_WINDOWS
+    /* only the CPUs of the first processor group */
+    DWORD_PTR mask = (DWORD_PTR)set->bits[0];
+
+    return (mask == 0 || SetThreadAffinityMask(GetCurrentThread(), mask) == 0) ? -1 : 0;
+#else
+    UNUSED_PARAMETER(set);
+    return -1;
+#endif
+}
+
+/* ---------------------------------------------------------------------------
+ * get the first NUMA node holding CPUs of a set, return -1 if unknown
+ */
+int davs2_cpu_set_get_node(const davs2_cpu_set_t *set)
+{
+    davs2_cpu_set_t node_set;
+    int node, i;
+
+    for (node = 0; node < DAVS2_MAX_NODES; node++) {
+        if (davs2_cpu_set_numa_node(&node_set, node) < 0) {
+            continue;
+        }
+        for (i = 0; i < DAVS2_MAX_CPUS / 64; i++) {
+            if (set->bits[i] & node_set.bits[i]) {
+                return node;
+            }
+        }
+    }
+
+    return -1;
+}
+
+/* ---------------------------------------------------------------------------
+ * place the memory allocated by the calling thread on a NUMA node (the thread
+ * keeps running on its CPUs). return 1 if the policy saved in 'saved' has to
+ * be restored by davs2_cpu_restore_mem_node(), 0 if nothing was changed
+ */
+int davs2_cpu_set_mem_node(int node, davs2_mem_policy_t *saved)
+{
+#if HAVE_MEMPOLICY
+    davs2_mem_policy_t policy;
+    const int bits = 8 * sizeof(unsigned long);
+
+    if (node < 0 || node >= DAVS2_MAX_NODES) {
+        return 0;
+    }
+    memset(saved, 0, sizeof(davs2_mem_policy_t));
+    if (syscall(SYS_get_mempolicy, &saved->mode, saved->nodes, (unsigned long)DAVS2_MAX_NODES, NULL, 0UL) != 0) {
+        return 0;
+    }
+    memset(&policy, 0, sizeof(policy));
+    policy.nodes[node / bits] = 1UL << (node % bits);
+    /* the kernel reads maxnode - 1 bits */
+    return syscall(SYS_set_mempolicy, DAVS2_MPOL_PREFERRED, policy.nodes, (unsigned long)DAVS2_MAX_NODES + 1) == 0;
+#else
+    /* no per-thread memory policy: the allocations follow the usual first-touch placement */
+    UNUSED_PARAMETER(node);
+    UNUSED_PARAMETER(saved);
+    return 0;
+#endif
+}
+
+/* ---------------------------------------------------------------------------
+ * restore the memory policy saved by davs2_cpu_set_mem_node()
+ */
+void davs2_cpu_restore_mem_node(const davs2_mem_policy_t *saved)
+{
+#if HAVE_MEMPOLICY
+    syscall(SYS_set_mempolicy, saved->mode, saved->nodes, (unsigned long)DAVS2_MAX_NODES + 1);
+#else
+    UNUSED_PARAMETER(saved);
+#endif
+}
@@ -42,6 +42,18 @@ extern "C" {
 uint32_t davs2_cpu_detect(void);
 #define davs2_cpu_num_processors FPFX(cpu_num_processors)
 int  davs2_cpu_num_processors(void);
+#define davs2_cpu_set_parse FPFX(cpu_set_parse)
+int  davs2_cpu_set_parse(davs2_cpu_set_t *set, const char *cpu_list);
+#define davs2_cpu_set_numa_node FPFX(cpu_set_numa_node)
+int  davs2_cpu_set_numa_node(davs2_cpu_set_t *set, int node);
+#define davs2_cpu_set_affinity FPFX(cpu_set_affinity)
+int  davs2_cpu_set_affinity(const davs2_cpu_set_t *set);
+#define davs2_cpu_set_get_node FPFX(cpu_set_get_node)
+int  davs2_cpu_set_get_node(const davs2_cpu_set_t *set);
+#define davs2_cpu_set_mem_node FPFX(cpu_set_mem_node)
+int  davs2_cpu_set_mem_node(int node, davs2_mem_policy_t *saved);
+#define davs2_cpu_restore_mem_node FPFX(cpu_restore_mem_node)
+void davs2_cpu_restore_mem_node(const davs2_mem_policy_t *saved);
 #define avs_cpu_emms FPFX(avs_cpu_emms)
 void avs_cpu_emms(void);
 #define avs_cpu_mask_misalign_sse FPFX(avs_cpu_mask_misalign_sse)
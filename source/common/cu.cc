@@ -41,6 +41,7 @@
 #include "mc.h"
 #include "sao.h"
 #include "quant.h"
+#include "frame.h"
 #include "scantab.h"
 
 /**
@@ -294,27 +295,26 @@ void cu_init(davs2_t *h, cu_t *p_cu, int i_level, int scu_xy, int pix_x)
 }
 
 /* ---------------------------------------------------------------------------
+ * copies the CU info to the other SCUs of the CU, but the slice index: it is
+ * already set, and may be read by the parser of the next slice (pipeline)
  */
 static INLINE
 void cu_read_end(davs2_t *h, cu_t *p_cu, int i_level, int scu_xy)
 {
+    const size_t offset = offsetof(cu_t, i_cu_level);
     cu_t *p_cu_iter = &h->scu_data[scu_xy];
     int size_in_scu = 1 << (i_level - MIN_CU_SIZE_IN_BIT);
-    int i;
+    int i, j;
 
     if (size_in_scu <= 1) {
         return;
     }
 
-    /* the fist row */
-    for (i = 1; i < size_in_scu; i++) {
-        memcpy(p_cu_iter + i, p_cu, sizeof(cu_t));
-    }
-
-    /* the left rows */
-    for (i = 1; i < size_in_scu; i++) {
+    for (i = 0; i < size_in_scu; i++) {
+        for (j = (i == 0); j < size_in_scu; j++) {
+            memcpy((uint8_t *)(p_cu_iter + j) + offset, (uint8_t *)p_cu + offset, sizeof(cu_t) - offset);
+        }
         p_cu_iter += h->i_width_in_scu;
-        memcpy(p_cu_iter, p_cu, size_in_scu * sizeof(cu_t));
     }
 }
 
@@ -325,7 +325,7 @@ static int cu_read_intrapred_mode_luma(davs2_t *h, aec_t *p_aec, cu_t *p_cu, int
     int size_in_scu = 1 << (p_cu->i_cu_level - MIN_CU_SIZE_IN_BIT);
     int i_intramode = h->i_ipredmode;
     int8_t *p_intramode = h->p_ipredmode + bj * i_intramode + bi;
-    int intra_mode_top  = p_intramode[-i_intramode];
+    int intra_mode_top  = bj != h->i_slice_spu_y ? p_intramode[-i_intramode] : DC_PRED;  /* not above the slice */
     int intra_mode_left = p_intramode[-1];
     int luma_mode = aec_read_intra_pmode(p_aec);
     int mpm[2];
@@ -600,15 +600,9 @@ static int cu_read_all_coeffs(davs2_t *h, aec_t *p_aec, cu_t *p_cu)
 {
     runlevel_t *runlevel = &h->lcu.cg_info;
     int idx_cu_zscan = h->lcu.idx_cu_zscan_aec;
-#if CTRL_AEC_THREAD
-    coeff_t *coeff_y = &h->lcu.lcu_aec->rec_info.coeff_buf_y    [idx_cu_zscan << 6];
-    coeff_t *coeff_u = &h->lcu.lcu_aec->rec_info.coeff_buf_uv[0][idx_cu_zscan << 4];
-    coeff_t *coeff_v = &h->lcu.lcu_aec->rec_info.coeff_buf_uv[1][idx_cu_zscan << 4];
-#else
-    coeff_t *coeff_y = &h->lcu.rec_info.coeff_buf_y    [idx_cu_zscan << 6];
-    coeff_t *coeff_u = &h->lcu.rec_info.coeff_buf_uv[0][idx_cu_zscan << 4];
-    coeff_t *coeff_v = &h->lcu.rec_info.coeff_buf_uv[1][idx_cu_zscan << 4];
-#endif
+    coeff_t *coeff_y = &h->lcu.p_rec_aec->coeff_buf_y    [idx_cu_zscan << 6];
+    coeff_t *coeff_u = &h->lcu.p_rec_aec->coeff_buf_uv[0][idx_cu_zscan << 4];
+    coeff_t *coeff_v = &h->lcu.p_rec_aec->coeff_buf_uv[1][idx_cu_zscan << 4];
     int bit_size   = p_cu->i_cu_level;
     int i_tu_level = p_cu->i_cu_level;  // 与变换块中包含的系数相关
     int b8;
@@ -636,9 +630,7 @@ static int cu_read_all_coeffs(davs2_t *h, aec_t *p_aec, cu_t *p_cu)
             int wq_size_id = DAVS2_MIN(3, bit_size - B4X4_IN_BIT);
 
             cu_get_quant_params(h, p_cu->i_qp, bit_size - (p_cu->i_trans_size != TU_SPLIT_NON), &shift, &scale);
-#if !CTRL_AEC_THREAD
             gf_davs2.fast_memzero(coeff_y, sizeof(coeff_t) * blocksize * blocksize);
-#endif
 
             p_cu->dct_pattern[0] = cu_get_block_coeffs(p_aec, runlevel, p_cu, coeff_y,
                                                        blocksize, blocksize, i_tu_level,
@@ -677,9 +669,7 @@ static int cu_read_all_coeffs(davs2_t *h, aec_t *p_aec, cu_t *p_cu)
                 int intra_pred_class = IS_INTRA(p_cu) ? tab_intra_mode_scan_type[p_cu->intra_pred_modes[b8]] : INTRA_PRED_DC_DIAG;
                 int b_swap_xy = (IS_INTRA(p_cu) && intra_pred_class == INTRA_PRED_HOR && p_cu->i_cu_type != PRED_I_2Nxn && p_cu->i_cu_type != PRED_I_nx2N);
                 coeff_t *p_res = coeff_y + (b8 << ((bit_size - 1) << 1));
-#if !CTRL_AEC_THREAD
                 gf_davs2.fast_memzero(p_res, sizeof(coeff_t) * bsx * bsy);
-#endif
                 p_cu->dct_pattern[b8] = cu_get_block_coeffs(p_aec, runlevel, p_cu, p_res,
                                                             bsx, bsy, i_tu_level,
                                                             1, intra_pred_class, b_swap_xy,
@@ -711,9 +701,7 @@ static int cu_read_all_coeffs(davs2_t *h, aec_t *p_aec, cu_t *p_cu)
                 int blocksize = 1 << wq_size_id;
                 coeff_t *p_res = uv ? coeff_v : coeff_u;
                 int shift, scale;
-#if !CTRL_AEC_THREAD
                 gf_davs2.fast_memzero(p_res, sizeof(coeff_t) * blocksize * blocksize);
-#endif
                 cu_get_quant_params(h, cu_get_chroma_qp(h, p_cu->i_qp, uv), wq_size_id, &shift, &scale);
 
                 p_cu->dct_pattern[4 + uv] = cu_get_block_coeffs(p_aec, runlevel, p_cu, p_res,
@@ -889,25 +877,35 @@ void decoder_wait_lcu_row(davs2_t *h, davs2_frame_t *frame, int line)
     line = DAVS2_MAX(line, 0);
     line = DAVS2_MIN(line, h->i_height_in_lcu - 1);
 
-    if (frame->i_decoded_line < line && frame->num_decoded_lcu_in_row[line] < h->i_width_in_lcu + 1) {
-        davs2_thread_mutex_lock(&frame->mutex_recon);
-
-        while (frame->i_decoded_line < line && frame->num_decoded_lcu_in_row[line] < h->i_width_in_lcu + 1) {
-            davs2_thread_cond_wait(&frame->conds_lcu_row[line], &frame->mutex_recon);
-        }
-
-        davs2_thread_mutex_unlock(&frame->mutex_recon);
+    /* the rows are finished in order */
+    if (davs2_atomic_load(&frame->num_decoded_lcu_in_row[line]) < LCU_ROW_FINISHED(h->i_width_in_lcu)) {
+        davs2_frame_wait_lcu_row(frame, line, LCU_ROW_FINISHED(h->i_width_in_lcu));
     }
 }
 
 /* ---------------------------------------------------------------------------
+ * wait until the reference samples in [min_x, max_x] x [min_y, max_y] of a
+ * frame are final. the rows above are finished before a row is filtered, so
+ * only the LCU columns up to max_x of the bottom row are waited for
  */
-void decoder_wait_row(davs2_t *h, davs2_frame_t *frame, int max_y_in_pic)
+void decoder_wait_row(davs2_t *h, davs2_frame_t *frame, int min_x_in_pic, int max_x_in_pic, int min_y_in_pic, int max_y_in_pic)
 {
-    int line = (max_y_in_pic + 8) >> h->i_lcu_level;
+    const int width_in_lcu = h->i_width_in_lcu;
+    int line = (max_y_in_pic + 16) >> h->i_lcu_level;
+    int num_lcu;
+
     line = DAVS2_MAX(line, 0);
     line = DAVS2_MIN(line, h->i_height_in_lcu - 1);
-    decoder_wait_lcu_row(h, frame, line);
+
+    if (min_x_in_pic < 0 || max_x_in_pic >= h->i_width || min_y_in_pic < 0 || max_y_in_pic >= h->i_height) {
+        num_lcu = LCU_ROW_FINISHED(width_in_lcu);   /* the padding is referenced */
+    } else {
+        num_lcu = LCU_ROW_FILTERED(width_in_lcu, (max_x_in_pic >> h->i_lcu_level) + 1);
+    }
+
+    if (davs2_atomic_load(&frame->num_decoded_lcu_in_row[line]) < num_lcu) {
+        davs2_frame_wait_lcu_row(frame, line, num_lcu);
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -1033,14 +1031,16 @@ static int davs2_get_inter_pred(davs2_t *h, davs2_row_rec_t *row_rec, cu_t *p_cu
 
             pel_t *p_pred = row_rec->ctu.p_fdec[IMG_Y] + pix_y * i_pred + pix_x;
 
-            decoder_wait_row(h, p_fref1, (vec1_y >> mv_shift) + height + 8 + 4);
+            decoder_wait_row(h, p_fref1, (vec1_x >> mv_shift) - 4, (vec1_x >> mv_shift) + width + 4,
+                             (vec1_y >> mv_shift) - 4, (vec1_y >> mv_shift) + height + 4);
 
             mc_luma(h, p_pred, i_pred, vec1_x, vec1_y, width, height, p_fref1->planes[IMG_Y], i_fref);
 
             if (p_fref2 != NULL) {
                 pel_t *p_temp = row_rec->pred_blk;
 
-                decoder_wait_row(h, p_fref2, (vec2_y >> mv_shift) + height + 8 + 4);
+                decoder_wait_row(h, p_fref2, (vec2_x >> mv_shift) - 4, (vec2_x >> mv_shift) + width + 4,
+                                 (vec2_y >> mv_shift) - 4, (vec2_y >> mv_shift) + height + 4);
 
                 mc_luma(h, p_temp, LCU_STRIDE, vec2_x, vec2_y, width, height, p_fref2->planes[IMG_Y], i_fref);
 
@@ -1220,8 +1220,8 @@ void decode_lcu_init(davs2_t *h, int i_lcu_x, int i_lcu_y)
     h->lcu.i_pix_width  = lcu_w_in_scu << MIN_CU_SIZE_IN_BIT;
     h->lcu.i_pix_height = lcu_h_in_scu << MIN_CU_SIZE_IN_BIT;
 
-    // init slice index of current LCU
-    for (i = 0; i < lcu_h_in_scu; i++) {
+    // init slice index of current LCU (written before the slices are parsed in parallel)
+    for (i = 0; i < lcu_h_in_scu && h->i_slice_job < 0; i++) {
         cu_t *p_cu_iter = &h->scu_data[h->lcu.i_scu_xy + i * width_in_scu];
 
         for (j = 0; j < lcu_w_in_scu; j++) {
@@ -1235,11 +1235,12 @@ void decode_lcu_init(davs2_t *h, int i_lcu_x, int i_lcu_y)
  */
 void rowrec_lcu_init(davs2_t *h, davs2_row_rec_t *row_rec, int i_lcu_x, int i_lcu_y)
 {
-#if CTRL_AEC_THREAD
-    row_rec->p_rec_info = &row_rec->lcu_info->rec_info;
-#else
-    row_rec->p_rec_info = &h->lcu.rec_info;
-#endif
+    if (h->rec_ring != NULL) {
+        /* pipelined: the coefficients are handed over by the parser */
+        row_rec->p_rec_info = &h->rec_ring[(i_lcu_y * h->i_width_in_lcu + i_lcu_x) % h->num_rec_ring];
+    } else {
+        row_rec->p_rec_info = &h->lcu.rec_info;
+    }
     row_rec->idx_cu_zscan = 0;
     /* CTU position */
     row_rec->ctu.i_pix_x = i_lcu_x << h->i_lcu_level;
@@ -74,7 +74,7 @@ int  decode_lcu_recon(davs2_t *h, davs2_row_rec_t *row_rec, int i_level, int pix
 #define decoder_wait_lcu_row FPFX(decoder_wait_lcu_row)
 void decoder_wait_lcu_row(davs2_t *h, davs2_frame_t *frame, int max_y_in_pic);
 #define decoder_wait_row FPFX(decoder_wait_row)
-void decoder_wait_row(davs2_t *h, davs2_frame_t *frame, int max_y_in_pic);
+void decoder_wait_row(davs2_t *h, davs2_frame_t *frame, int min_x_in_pic, int max_x_in_pic, int min_y_in_pic, int max_y_in_pic);
 
 #ifdef __cplusplus
 }
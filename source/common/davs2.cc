@@ -80,6 +80,9 @@ es_unit_alloc(int buf_size)
     es_unit->len  = 0;
     es_unit->pts  = 0;
     es_unit->dts  = 0;
+    es_unit->borrowed       = NULL;
+    es_unit->release        = NULL;
+    es_unit->release_opaque = NULL;
 
     return es_unit;
 }
@@ -94,13 +97,23 @@ es_unit_free(es_unit_t *es_unit)
     }
 }
 
+#define DAVS2_ISUNIT(x) ((x) == 0xB0 || (x) == 0xB1 || (x) == 0xB7 || (x) == 0xB3 || (x) == 0xB6)
+
+/* ---------------------------------------------------------------------------
+ * does the packet terminate the buffered es_unit (which is then decoded)?
+ */
+static INLINE
+int davs2_packet_ends_es_unit(davs2_mgr_t *mgr, const uint8_t *data, int len)
+{
+    return len > 0 && DAVS2_ISUNIT(data[3]) && mgr->es_unit != NULL && mgr->es_unit->len > 0;
+}
+
 /* ---------------------------------------------------------------------------
  * push byte stream data of one frame to input list
  */
 static
-es_unit_t *davs2_pack_es_unit(davs2_mgr_t *mgr, const uint8_t *data, int len, int64_t pts, int64_t dts)
+es_unit_t *davs2_pack_es_unit(davs2_mgr_t *mgr, const uint8_t *data, int len, int64_t pts, int64_t dts, int flags)
 {
-#define DAVS2_ISUNIT(x) ((x) == 0xB0 || (x) == 0xB1 || (x) == 0xB7 || (x) == 0xB3 || (x) == 0xB6)
     es_unit_t *es_unit     = NULL;
     es_unit_t *ret_es_unit = NULL;
     int start_code = data[3];
@@ -140,6 +153,7 @@ es_unit_t *davs2_pack_es_unit(davs2_mgr_t *mgr, const uint8_t *data, int len, in
         es_unit->len += len;
         es_unit->pts  = pts;
         es_unit->dts  = dts;
+        es_unit->flags = flags;
     }
 
     /* check the pseudo start code */
@@ -147,7 +161,6 @@ es_unit_t *davs2_pack_es_unit(davs2_mgr_t *mgr, const uint8_t *data, int len, in
         ret_es_unit->len = bs_dispose_pseudo_code(ret_es_unit->data, ret_es_unit->data, ret_es_unit->len);
     }
 
-#undef DAVS2_ISUNIT
     return ret_es_unit;
 }
 
@@ -239,11 +252,61 @@ int has_new_output_frame(davs2_mgr_t *mgr, davs2_t *h)
     return 1;  // ͼط㣬ͼ0
 }
 
+/* ---------------------------------------------------------------------------
+ * is any frame with POC in [outpics.output, poc) still under decoding?
+ * (called with mutex_mgr locked)
+ */
+static
+int output_list_is_decoding(davs2_mgr_t *mgr, int poc)
+{
+    int i;
+
+    for (i = 0; i < mgr->num_decoders; i++) {
+        davs2_t *h = &mgr->decoders[i];
+        davs2_frame_t *frame = h->fdec;
+
+        if (h->task_info.task_status != TASK_FREE && frame != NULL &&
+            frame->i_poc >= mgr->outpics.output && frame->i_poc < poc) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * move the output over the POCs dropped in catch-up mode
+ * (called with mutex_mgr locked)
+ */
+static
+void output_list_pass_skipped(davs2_mgr_t *mgr)
+{
+    davs2_output_t *pics = &mgr->outpics;
+    int i = 0;
+
+    while (i < pics->num_skipped) {
+        int poc = pics->skipped[i];
+
+        if (poc > pics->output) {
+            i++;
+            continue;
+        }
+
+        if (poc == pics->output) {
+            pics->output++;
+        }
+        pics->skipped[i] = pics->skipped[--pics->num_skipped];
+        i = 0;  /* the next POC may be dropped too */
+    }
+}
+
 /* ---------------------------------------------------------------------------
  */
 static
-davs2_outpic_t *output_list_get_one_output_picture(davs2_mgr_t *mgr)
+davs2_outpic_t *output_list_get_one_output_picture(davs2_mgr_t *mgr, int b_wait)
 {
+    /* skip a missing POC once more frames than the reorder window are queued after it */
+    const int max_delayed_frames = mgr->param.low_latency ? mgr->seq_info.picture_reorder_delay + 1 : 8;
     davs2_outpic_t *pic   = NULL;
 
     davs2_thread_mutex_lock(&mgr->mutex_mgr);
@@ -252,6 +315,8 @@ davs2_outpic_t *output_list_get_one_output_picture(davs2_mgr_t *mgr)
         davs2_frame_t *frame = mgr->outpics.pics->frame;
         assert(frame);
 
+        output_list_pass_skipped(mgr);
+
         if (frame->i_poc == mgr->outpics.output) {
             /* the next frame : output */
             pic = mgr->outpics.pics;
@@ -282,11 +347,14 @@ davs2_outpic_t *output_list_get_one_output_picture(davs2_mgr_t *mgr)
                     pic = pic->next;
                 }
 
-                if (num_delayed_frames < 8) {
-                    /* keep waiting */
-                    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
-                    davs2_sleep_ms(1);
-                    davs2_thread_mutex_lock(&mgr->mutex_mgr);
+                if (num_delayed_frames < max_delayed_frames || output_list_is_decoding(mgr, frame->i_poc)) {
+                    if (!b_wait) {
+                        pic = NULL;
+                        break;
+                    }
+
+                    /* keep waiting for the next frame put into the output list */
+                    davs2_thread_cond_wait(&mgr->cond_output, &mgr->mutex_mgr);
                     continue;
                 }
             }
@@ -304,13 +372,101 @@ davs2_outpic_t *output_list_get_one_output_picture(davs2_mgr_t *mgr)
     return pic;
 }
 
+/* ---------------------------------------------------------------------------
+ * wait until a frame is put into the output list after num_inserted ones
+ */
+static
+void output_list_wait_picture(davs2_mgr_t *mgr, int num_inserted)
+{
+    davs2_thread_mutex_lock(&mgr->mutex_mgr);
+    while (mgr->outpics.num_inserted == num_inserted) {
+        davs2_thread_cond_wait(&mgr->cond_output, &mgr->mutex_mgr);
+    }
+    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+}
+
+/* ---------------------------------------------------------------------------
+ */
+static
+void output_list_write_picture(davs2_mgr_t *mgr, davs2_outpic_t *pic, davs2_picture_t *out_frame)
+{
+    mgr->num_frames_out++;
+
+    /* copy out */
+    davs2_write_a_frame(pic->pic, pic->frame);
+
+    /* release reference when it would no more be needed */
+    if (pic->pic->dec_frame == NULL) {
+        release_one_frame(pic->frame);
+    }
+
+    /* deliver this frame */
+    memcpy(out_frame, pic->pic, sizeof(davs2_picture_t));
+    out_frame->magic       = pic;
+}
+
+/* ---------------------------------------------------------------------------
+ * deliver frames to the frame callback in display order
+ */
+void decoder_deliver_output(davs2_mgr_t *mgr, int is_flush)
+{
+    davs2_outpic_t *pic = NULL;
+    davs2_picture_t out_frame;
+
+    /* one frame at a time */
+    davs2_thread_mutex_lock(&mgr->mutex_output);
+
+    while (mgr->num_frames_in > mgr->num_frames_out) {
+        int num_inserted = mgr->outpics.num_inserted;
+
+        pic = output_list_get_one_output_picture(mgr, 0);
+
+        if (pic == NULL) {
+            if (!is_flush) {
+                break;          /* the next frame is not ready yet */
+            }
+
+            /* never wait with mutex_output locked, the decoding threads
+             * delivering their frames meanwhile may be those waited for */
+            davs2_thread_mutex_unlock(&mgr->mutex_output);
+            output_list_wait_picture(mgr, num_inserted);
+            davs2_thread_mutex_lock(&mgr->mutex_output);
+            continue;
+        }
+
+        output_list_write_picture(mgr, pic, &out_frame);
+        mgr->frame_callback(mgr->frame_callback_opaque, pic->head, &out_frame);
+    }
+
+    davs2_thread_mutex_unlock(&mgr->mutex_output);
+}
+
 /* --------------------------------------------------------------------------
  * Thread of decoder output (decoded raw data)
  */
 int decoder_get_output(davs2_mgr_t *mgr, davs2_seq_info_t *headerset, davs2_picture_t *out_frame, int is_flush)
 {
     davs2_outpic_t *pic   = NULL;
-    int b_wait_new_frame = mgr->num_frames_in + mgr->num_decoders - mgr->num_frames_out > 8 + mgr->num_aec_thread;
+    /* frames in flight: keep all frame threads busy in addition to the frames waiting for reordering */
+    int b_wait_new_frame = mgr->num_frames_in - mgr->num_frames_out >
+                           DAVS2_MAX(7, mgr->seq_info.picture_reorder_delay + mgr->num_aec_thread);
+
+    if (mgr->frame_callback != NULL) {
+        /* frames are delivered by the callback, only sequence headers are returned here */
+        if (is_flush) {
+            decoder_deliver_output(mgr, 1);
+        }
+        b_wait_new_frame = 0;
+        is_flush         = 0;
+    } else if (mgr->param.low_latency) {
+        /* wait only when more frames are in flight than the threads and the reorder window need,
+         * otherwise take the next frame in display order if it has been decoded */
+        b_wait_new_frame = mgr->num_frames_in - mgr->num_frames_out >
+                           mgr->seq_info.picture_reorder_delay + mgr->num_aec_thread - 1;
+        if (!b_wait_new_frame && !is_flush && !mgr->new_sps && mgr->num_frames_in > mgr->num_frames_out) {
+            pic = output_list_get_one_output_picture(mgr, 0);
+        }
+    }
 
     while (mgr->num_frames_in > mgr->num_frames_out && /* no more output */
            (b_wait_new_frame || is_flush)) {
@@ -322,10 +478,11 @@ int decoder_get_output(davs2_mgr_t *mgr, davs2_seq_info_t *headerset, davs2_pict
         }
 
         /* check for the next frame */
-        pic = output_list_get_one_output_picture(mgr);
+        int num_inserted = mgr->outpics.num_inserted;
+        pic = output_list_get_one_output_picture(mgr, 1);
 
         if (pic == NULL) {
-            davs2_sleep_ms(1);
+            output_list_wait_picture(mgr, num_inserted);
         } else {
             break;
         }
@@ -341,19 +498,8 @@ int decoder_get_output(davs2_mgr_t *mgr, davs2_seq_info_t *headerset, davs2_pict
         return DAVS2_DEFAULT;
     }
 
-    mgr->num_frames_out++;
-
-    /* copy out */
-    davs2_write_a_frame(pic->pic, pic->frame);
-
-    /* release reference when it would no more be needed */
-    if (pic->pic->dec_frame == NULL) {
-        release_one_frame(pic->frame);
-    }
+    output_list_write_picture(mgr, pic, out_frame);
 
-    /* deliver this frame */
-    memcpy(out_frame, pic->pic, sizeof(davs2_picture_t));
-    out_frame->magic       = pic;
     return DAVS2_GOT_FRAME;
 }
 
@@ -388,26 +534,125 @@ davs2_decoder_frame_unref(void *decoder, davs2_picture_t *out_frame)
     }
 }
 
+/**
+ * ---------------------------------------------------------------------------
+ * Function   : set a callback to receive output frames
+ * Parameters :
+ *       [in] : decoder   - decoder handle
+ *       [in] : callback  - called with each frame in display order as soon as it is decoded (NULL: disable)
+ *       [in] : opaque    - user data passed to the callback
+ * Return     : 0 for success, -1 when there are frames not output yet
+ * ---------------------------------------------------------------------------
+ */
+DAVS2_API int
+davs2_decoder_set_frame_callback(void *decoder, davs2_frame_callback_t callback, void *opaque)
+{
+    davs2_mgr_t *mgr = (davs2_mgr_t *)decoder;
+    int ret = 0;
+
+    if (mgr == NULL) {
+        return -1;
+    }
+
+    davs2_thread_mutex_lock(&mgr->mutex_output);
+    if (mgr->num_frames_in != mgr->num_frames_out) {
+        davs2_log(mgr, DAVS2_LOG_ERROR, "frame callback could only be changed when all frames are output\n");
+        ret = -1;
+    } else {
+        mgr->frame_callback        = callback;
+        mgr->frame_callback_opaque = opaque;
+    }
+    davs2_thread_mutex_unlock(&mgr->mutex_output);
+
+    return ret;
+}
+
+/**
+ * ---------------------------------------------------------------------------
+ * Function   : set a callback to receive the decoding progress of each frame (LCU-row granularity)
+ * Parameters :
+ *       [in] : decoder   - decoder handle
+ *       [in] : callback  - called each time more lines of a frame become final (NULL: disable)
+ *       [in] : opaque    - user data passed to the callback
+ * Return     : 0 for success, -1 when there are frames not output yet
+ * ---------------------------------------------------------------------------
+ */
+DAVS2_API int
+davs2_decoder_set_rows_callback(void *decoder, davs2_rows_callback_t callback, void *opaque)
+{
+    davs2_mgr_t *mgr = (davs2_mgr_t *)decoder;
+    int ret = 0;
+
+    if (mgr == NULL) {
+        return -1;
+    }
+
+    davs2_thread_mutex_lock(&mgr->mutex_output);
+    if (mgr->num_frames_in != mgr->num_frames_out) {
+        davs2_log(mgr, DAVS2_LOG_ERROR, "rows callback could only be changed when all frames are output\n");
+        ret = -1;
+    } else {
+        mgr->rows_callback        = callback;
+        mgr->rows_callback_opaque = opaque;
+    }
+    davs2_thread_mutex_unlock(&mgr->mutex_output);
+
+    return ret;
+}
+
+/**
+ * ---------------------------------------------------------------------------
+ * Function   : switch the catch-up mode (drop the non-reference pictures)
+ * Parameters :
+ *       [in] : decoder   - decoder handle
+ *       [in] : enable    - 1: drop the pictures no other picture references, 0: decode all
+ * Return     : none
+ * ---------------------------------------------------------------------------
+ */
+DAVS2_API void
+davs2_decoder_set_catch_up(void *decoder, int enable)
+{
+    davs2_mgr_t *mgr = (davs2_mgr_t *)decoder;
+
+    if (mgr != NULL) {
+        davs2_atomic_store(&mgr->b_catch_up, enable != 0);
+    }
+}
+
 /* --------------------------------------------------------------------------
+ * take a free task, wait until one is freed if all of them are busy or if
+ * enough frames are being parsed
  */
 static davs2_t *task_get_free_task(davs2_mgr_t *mgr)
 {
-    int i;
+    davs2_t *h = NULL;
 
-    for (; mgr->b_exit == 0;) {
-        for (i = 0; i < mgr->num_decoders; i++) {
-            davs2_t *h = &mgr->decoders[i];
-            davs2_thread_mutex_lock(&mgr->mutex_mgr);
-            if (h->task_info.task_status == TASK_FREE) {
-                h->task_info.task_status = TASK_BUSY;
-                davs2_thread_mutex_unlock(&mgr->mutex_mgr);
-                return h;
-            }
-            davs2_thread_mutex_unlock(&mgr->mutex_mgr);
-        }
+    davs2_thread_mutex_lock(&mgr->mutex_mgr);
+    while ((mgr->num_free_tasks == 0 || mgr->num_frames_parsing >= mgr->num_frames_max) && mgr->b_exit == 0) {
+        davs2_thread_cond_wait(&mgr->cond_task, &mgr->mutex_mgr);
     }
+    if (mgr->num_free_tasks > 0) {
+        h = mgr->free_tasks[--mgr->num_free_tasks];
+        h->task_info.task_status = TASK_BUSY;
+    }
+    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
 
-    return NULL;
+    return h;
+}
+
+/* --------------------------------------------------------------------------
+ * are there enough free tasks for the next es_units?
+ * tasks are only taken by the API thread, so the answer holds until then
+ */
+static int task_has_free_tasks(davs2_mgr_t *mgr, int num_tasks)
+{
+    int b_free;
+
+    davs2_thread_mutex_lock(&mgr->mutex_mgr);
+    b_free = mgr->num_free_tasks >= num_tasks && mgr->num_frames_parsing + num_tasks <= mgr->num_frames_max;
+    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+
+    return b_free;
 }
 
 /* --------------------------------------------------------------------------
@@ -417,6 +662,16 @@ void task_unload_packet(davs2_t *h, es_unit_t *es_unit)
     davs2_mgr_t *mgr = h->task_info.taskmgr;
 
     if (es_unit) {
+        /* give back the byte stream lent by the application */
+        if (es_unit->borrowed != NULL) {
+            if (es_unit->release != NULL) {
+                es_unit->release(es_unit->release_opaque, es_unit->borrowed);
+            }
+            es_unit->borrowed       = NULL;
+            es_unit->release        = NULL;
+            es_unit->release_opaque = NULL;
+        }
+
         /* packet is free */
         es_unit->len = 0;
         xl_append(&mgr->packets_idle, es_unit);
@@ -424,7 +679,75 @@ void task_unload_packet(davs2_t *h, es_unit_t *es_unit)
 
     davs2_thread_mutex_lock(&mgr->mutex_mgr);
     h->task_info.task_status = TASK_FREE;
+    mgr->free_tasks[mgr->num_free_tasks++] = h;
     davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+
+    davs2_thread_cond_signal(&mgr->cond_task);
+}
+
+/* --------------------------------------------------------------------------
+ * a frame has been parsed (its task may still be busy with the reconstruction)
+ */
+void task_frame_parsed(davs2_mgr_t *mgr, int wait_ref_us)
+{
+    davs2_atomic_fetch_add(&mgr->wait_ref_us, wait_ref_us);
+
+    davs2_thread_mutex_lock(&mgr->mutex_mgr);
+    mgr->num_frames_parsing--;
+    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+
+    davs2_thread_cond_signal(&mgr->cond_task);
+}
+
+/* --------------------------------------------------------------------------
+ * moves the threads between frame and row parallelism (pipeline): fewer frames
+ * are parsed in parallel when the parsers mostly wait for the rows of their
+ * reference frames, more when the reconstruction mostly waits for the parsers
+ */
+static void task_adapt_frame_parallelism(davs2_mgr_t *mgr)
+{
+    int64_t wait_ref_us;        /* per parser */
+    int64_t wait_parse_us;      /* per reconstruction thread */
+    int wait_ref_total;
+    int wait_parse_total;
+
+    if (mgr->rec_pool == NULL || ++mgr->num_frames_split < DAVS2_SPLIT_FRAMES) {
+        return;
+    }
+    mgr->num_frames_split = 0;
+
+    wait_ref_total   = davs2_atomic_fetch_add(&mgr->wait_ref_us, 0);
+    wait_parse_total = davs2_atomic_fetch_add(&mgr->wait_parse_us, 0);
+    davs2_atomic_fetch_add(&mgr->wait_ref_us, -wait_ref_total);
+    davs2_atomic_fetch_add(&mgr->wait_parse_us, -wait_parse_total);
+    wait_ref_us   = wait_ref_total / mgr->num_frames_max;
+    wait_parse_us = wait_parse_total / mgr->num_rec_thread;
+
+    davs2_thread_mutex_lock(&mgr->mutex_mgr);
+    if (wait_ref_us > 2 * wait_parse_us && mgr->num_frames_max > 1) {
+        mgr->num_frames_max--;
+    } else if (wait_parse_us > 2 * wait_ref_us && mgr->num_frames_max < mgr->num_aec_thread) {
+        mgr->num_frames_max++;
+    }
+    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+
+    davs2_log(mgr, DAVS2_LOG_DEBUG, "%d frame(s) parsed in parallel, waiting %d us for references, %d us for parsers",
+              mgr->num_frames_max, (int)wait_ref_us, (int)wait_parse_us);
+}
+
+/* ---------------------------------------------------------------------------
+ * binds a thread of the decoder to its CPUs (thread pool init)
+ */
+static void *decoder_bind_thread(void *arg1, int arg2)
+{
+    davs2_cpu_set_t *cpu_set = (davs2_cpu_set_t *)arg1;
+
+    UNUSED_PARAMETER(arg2);
+    if (cpu_set->num_cpus > 0) {
+        davs2_cpu_set_affinity(cpu_set);
+    }
+
+    return NULL;
 }
 
 
@@ -439,12 +762,20 @@ void task_unload_packet(davs2_t *h, es_unit_t *es_unit)
 DAVS2_API void *
 davs2_decoder_open(davs2_param_t *param)
 {
-    const int max_num_thread = CTRL_AEC_THREAD ? AVS2_THREAD_MAX : AVS2_THREAD_MAX / 2;
     char buf_cpu[120] = "";
     davs2_mgr_t *mgr = NULL;
     uint8_t *mem_ptr;
     size_t mem_size;
     uint32_t cpuid = 0;
+    int threads;
+    int num_aec_thread;
+    int num_rec_thread;
+    int num_flt_thread;
+    int num_decoders;
+    davs2_cpu_set_t cpu_set;
+    davs2_mem_policy_t mem_policy_saved;
+    int mem_node = -1;
+    int b_mem_node = 0;
     int i;
 
     /* output version information */
@@ -463,6 +794,10 @@ davs2_decoder_open(davs2_param_t *param)
         davs2_log(NULL, DAVS2_LOG_ERROR, "Invalid input parameters: Null parameters\n");
         return 0;
     }
+    if ((param->get_buffer == NULL) != (param->release_buffer == NULL)) {
+        davs2_log(NULL, DAVS2_LOG_ERROR, "Invalid input parameters: get_buffer and release_buffer should be set together\n");
+        return 0;
+    }
 
     /* init all function handlers */
 #if HAVE_MMX
@@ -479,27 +814,68 @@ davs2_decoder_open(davs2_param_t *param)
         davs2_log(mgr, DAVS2_LOG_INFO, "CPU Capabilities: %s", buf_cpu);
     }
 
+    /* number of threads and frame decoders (tasks) */
+    threads = param->threads;
+    if (threads <= 0) {
+        threads = davs2_cpu_num_processors();
+    }
+    if (threads > AVS2_THREAD_MAX) {
+        threads = AVS2_THREAD_MAX;
+        davs2_log(NULL, DAVS2_LOG_WARNING, "Max number of thread reached, forcing to be %d\n", AVS2_THREAD_MAX);
+    }
+    num_aec_thread = threads;
+    num_rec_thread = 0;
+    num_flt_thread = 0;
+    if (param->pipeline) {
+        /* up to half of the threads parse frames. the reconstruction has a thread for every
+         * CPU left by a single parser, num_frames_max moves the CPUs between the two. so
+         * up to about 1.5 x threads are busy when all the parsers run (see davs2.h) */
+        num_aec_thread = DAVS2_MAX(1, threads - (threads >> 1));
+        num_rec_thread = DAVS2_MAX(1, threads - 1);
+    }
+    if (param->pipeline > 1) {
+        num_flt_thread = DAVS2_MAX(1, num_rec_thread >> 1);
+        num_rec_thread = DAVS2_MAX(1, num_rec_thread - num_flt_thread);
+    }
+    /* a frame being reconstructed (and filtered) still holds its task after parsing */
+    num_decoders = num_aec_thread + num_rec_thread + 1 + (num_flt_thread > 0);
+
+    /* CPUs of the decoding threads, the decoder is allocated on their memory node */
+    memset(&cpu_set, 0, sizeof(cpu_set));
+    if (param->cpu_list != NULL && param->cpu_list[0] != '\0') {
+        if (davs2_cpu_set_parse(&cpu_set, param->cpu_list) < 0) {
+            davs2_log(NULL, DAVS2_LOG_WARNING, "Invalid CPU list \"%s\", the threads are not bound\n", param->cpu_list);
+            memset(&cpu_set, 0, sizeof(cpu_set));
+        }
+    } else if (param->numa_node > 0) {
+        if (davs2_cpu_set_numa_node(&cpu_set, param->numa_node - 1) < 0) {
+            davs2_log(NULL, DAVS2_LOG_WARNING, "Invalid NUMA node %d, the threads are not bound\n", param->numa_node - 1);
+            memset(&cpu_set, 0, sizeof(cpu_set));
+        }
+    }
+    if (cpu_set.num_cpus > 0) {
+        mem_node   = davs2_cpu_set_get_node(&cpu_set);
+        b_mem_node = davs2_cpu_set_mem_node(mem_node, &mem_policy_saved);
+    }
+
     mem_size = sizeof(davs2_mgr_t) + CACHE_LINE_SIZE
-        + AVS2_THREAD_MAX * (sizeof(davs2_t) + CACHE_LINE_SIZE);
+        + num_decoders * (sizeof(davs2_t) + CACHE_LINE_SIZE)
+        + num_decoders * sizeof(davs2_t *) + CACHE_LINE_SIZE;
     CHECKED_MALLOCZERO(mem_ptr, uint8_t *, mem_size);
 
     mgr = (davs2_mgr_t *)mem_ptr;
     mem_ptr += sizeof(davs2_mgr_t);
     ALIGN_POINTER(mem_ptr);
     memcpy(&mgr->param, param, sizeof(davs2_param_t));
+    mgr->param.threads  = threads;
+    mgr->param.cpu_list = NULL;
+    memcpy(&mgr->cpu_set, &cpu_set, sizeof(davs2_cpu_set_t));
+    mgr->i_mem_node = mem_node;
 
     /* init log module */
     mgr->module_log.i_log_level = param->info_level;
     sprintf(mgr->module_log.module_name, "Manager %06llx", (long long unsigned int)(mgr));
 
-    if (mgr->param.threads <= 0) {
-        mgr->param.threads = davs2_cpu_num_processors();
-    }
-    if (mgr->param.threads > max_num_thread) {
-        mgr->param.threads = max_num_thread;
-        davs2_log(mgr, DAVS2_LOG_WARNING, "Max number of thread reached, forcing to be %d\n", max_num_thread);
-    }
-
     /* init members that could not be zero */
     mgr->i_prev_coi       = -1;
 
@@ -508,28 +884,23 @@ davs2_decoder_open(davs2_param_t *param)
     mgr->outpics.pics     = NULL;
     mgr->outpics.num_output_pic = 0;
 
-    mgr->num_decoders     = mgr->param.threads;
-    mgr->num_total_thread = mgr->param.threads;
-    mgr->num_aec_thread   = mgr->param.threads;
-#if CTRL_AEC_THREAD
-    if (mgr->num_total_thread > 3) {
-        mgr->num_aec_thread = (mgr->param.threads >> 1) + 1;
-        mgr->num_rec_thread = mgr->num_total_thread - mgr->num_aec_thread;
-    } else {
-        mgr->num_rec_thread = 0;
-    }
-    mgr->num_decoders += 1 + mgr->num_aec_thread;
-#else
-    mgr->num_rec_thread = 0;
-#endif
-
-    mgr->num_decoders++;
+    mgr->num_aec_thread   = num_aec_thread;
+    mgr->num_rec_thread   = num_rec_thread;
+    mgr->num_flt_thread   = num_flt_thread;
+    mgr->num_total_thread = num_aec_thread + num_rec_thread + num_flt_thread;
+    mgr->num_decoders     = num_decoders;
+    mgr->num_frames_max   = num_aec_thread;
 
     mgr->decoders = (davs2_t *)mem_ptr;
-    mem_ptr      += AVS2_THREAD_MAX * sizeof(davs2_t);
+    mem_ptr      += num_decoders * sizeof(davs2_t);
+    ALIGN_POINTER(mem_ptr);
+    mgr->free_tasks = (davs2_t **)mem_ptr;
+    mem_ptr        += num_decoders * sizeof(davs2_t *);
     ALIGN_POINTER(mem_ptr);
     davs2_thread_mutex_init(&mgr->mutex_mgr, NULL);
-    davs2_thread_mutex_init(&mgr->mutex_aec, NULL);
+    davs2_thread_mutex_init(&mgr->mutex_output, NULL);
+    davs2_thread_cond_init(&mgr->cond_output, NULL);
+    davs2_thread_cond_init(&mgr->cond_task, NULL);
 
     /* init input&output lists */
     if (create_all_lists(mgr) < 0) {
@@ -563,15 +934,58 @@ davs2_decoder_open(davs2_param_t *param)
         h->task_info.taskmgr     = mgr;
     }
 
-    /* initialize thread pool for AEC decoding and reconstruction */
-    davs2_threadpool_init((davs2_threadpool_t **)&mgr->thread_pool, mgr->num_total_thread, NULL, NULL, 0);
+    /* all tasks are free, the first one on top */
+    for (i = mgr->num_decoders - 1; i >= 0; i--) {
+        mgr->free_tasks[mgr->num_free_tasks++] = &mgr->decoders[i];
+    }
+
+    /* initialize thread pool for AEC decoding and reconstruction. the tasks
+     * running on it queue slice jobs (slice_parallel), always through the
+     * non-blocking davs2_threadpool_try_run(), so a shared pool is never
+     * blocked by its own workers */
+    if (mgr->param.thread_pool != NULL) {
+        mgr->thread_pool = mgr->param.thread_pool;
+    } else {
+        if (davs2_threadpool_init((davs2_threadpool_t **)&mgr->thread_pool, mgr->num_aec_thread,
+                                  decoder_bind_thread, &mgr->cpu_set, 0) < 0) {
+            goto fail;
+        }
+    }
+
+    /* the reconstruction threads of the pipeline are never shared, so that the reconstruction
+     * of a frame the parser is waiting for cannot be held up by parsing jobs */
+    if (mgr->num_rec_thread > 0) {
+        if (davs2_threadpool_init((davs2_threadpool_t **)&mgr->rec_pool, mgr->num_rec_thread,
+                                  decoder_bind_thread, &mgr->cpu_set, 0) < 0) {
+            goto fail;
+        }
+    }
+
+    /* the filter jobs never wait, the reconstruction of the frames referencing
+     * a frame may be waiting for them */
+    if (mgr->num_flt_thread > 0) {
+        if (davs2_threadpool_init((davs2_threadpool_t **)&mgr->flt_pool, mgr->num_flt_thread,
+                                  decoder_bind_thread, &mgr->cpu_set, 0) < 0) {
+            goto fail;
+        }
+    }
 
-    davs2_log(mgr, DAVS2_LOG_INFO, "using %d thread(s): %d(frame/AEC)+%d(pool/REC), %d tasks", 
-        mgr->num_total_thread, mgr->num_aec_thread, mgr->num_rec_thread, mgr->num_decoders);
+    davs2_log(mgr, DAVS2_LOG_INFO, "using %d thread(s): %d(frame/AEC)+%d(pool/REC)+%d(pool/FLT), %d tasks", 
+        mgr->num_total_thread, mgr->num_aec_thread, mgr->num_rec_thread, mgr->num_flt_thread, mgr->num_decoders);
+    if (mgr->cpu_set.num_cpus > 0) {
+        davs2_log(mgr, DAVS2_LOG_INFO, "threads bound to %d CPU(s)", mgr->cpu_set.num_cpus);
+    }
+
+    if (b_mem_node) {
+        davs2_cpu_restore_mem_node(&mem_policy_saved);
+    }
 
     return mgr;
 
 fail:
+    if (b_mem_node) {
+        davs2_cpu_restore_mem_node(&mem_policy_saved);
+    }
     davs2_log(NULL, DAVS2_LOG_ERROR, "failed to open decoder\n");
     davs2_decoder_close(mgr);
 
@@ -587,33 +1001,43 @@ int decoder_decode_es_unit(davs2_mgr_t *mgr, es_unit_t *es_unit)
 
     /* decode this frame
      * (1) init bs */
-    bs_init(&es_unit->bs, es_unit->data, es_unit->len);
+    bs_init(&es_unit->bs, es_unit->borrowed != NULL ? es_unit->borrowed : es_unit->data, es_unit->len);
 
     h = task_get_free_task(mgr);
     mgr->h_dec = h;
 
-    davs2_thread_mutex_lock(&mgr->mutex_aec);
-
     h->task_info.curr_es_unit = es_unit;     /* record the ES_unit to be decoded */
 
-    /* (2) parse header */
+    /* (2) parse header. the es_units are only sent by the API thread in decoding
+     * order, so nothing here is serialized but the DPB update (under mutex_mgr),
+     * the frames sent before are set up by their own jobs meanwhile */
     if (parse_header(h, &es_unit->bs) == 0) {
         h->p_bs = &es_unit->bs;
-        /* prepare the reference list and the reconstruction buffer */
-        if (task_get_references(h, es_unit->pts, es_unit->dts) == 0) {
+        if ((mgr->b_catch_up || (es_unit->flags & DAVS2_PACKET_SKIP_NONREF)) && task_skip_picture(h) == 0) {
+            /* picture dropped, task is free */
+            task_unload_packet(h, es_unit);
+        } else if (task_get_references(h, es_unit->pts, es_unit->dts) == 0) {
+            /* prepare the reference list and the reconstruction buffer */
             b_wait_output = has_new_output_frame(mgr, h);
             mgr->num_frames_in++;
+            task_adapt_frame_parallelism(mgr);
+            davs2_thread_mutex_lock(&mgr->mutex_mgr);
+            mgr->num_frames_parsing++;
+            davs2_thread_mutex_unlock(&mgr->mutex_mgr);
 
-            davs2_thread_mutex_unlock(&mgr->mutex_aec);
-            /* decode picture data */
-            davs2_threadpool_run((davs2_threadpool_t *)mgr->thread_pool, decoder_decode_picture_data, h, 0, 0);
+            /* decode picture data. the pipelined frames stay in decoding order:
+             * the parser and the reconstruction of a frame wait for each other,
+             * so every frame depends on all the frames before it */
+            if (h->rec_ring != NULL) {
+                decoder_run_reconstruction(h);
+            }
+            davs2_threadpool_run((davs2_threadpool_t *)mgr->thread_pool, decoder_decode_picture_data, h, 0,
+                                 h->rec_ring != NULL ? DAVS2_JOB_PRIO_HIGH : h->fdec->i_job_priority, 0);
         } else { 
-            davs2_thread_mutex_unlock(&mgr->mutex_aec);
             /* task is free */
             task_unload_packet(h, es_unit);
         }
     } else {
-        davs2_thread_mutex_unlock(&mgr->mutex_aec);
         /* task is free */
         task_unload_packet(h, es_unit);
     }
@@ -622,11 +1046,39 @@ int decoder_decode_es_unit(davs2_mgr_t *mgr, es_unit_t *es_unit)
 }
 
 /* ---------------------------------------------------------------------------
+ * check an input packet, return 0 if it is valid, otherwise -1
  */
-DAVS2_API int
-davs2_decoder_send_packet(void *decoder, davs2_packet_t *packet)
+static int
+decoder_check_packet(davs2_mgr_t *mgr, davs2_packet_t *packet)
+{
+    /* check the input parameter: packet */
+    if (packet == NULL || packet->data == NULL || packet->len <= 0) {
+        davs2_log(mgr->decoders, DAVS2_LOG_DEBUG, "Null input packet");
+        return -1;                       /* error */
+    }
+
+    /* check packet length */
+    if (packet->len < 4) {
+        davs2_log(mgr, DAVS2_LOG_DEBUG, "Invalid packet, 4 bytes are needed for one packet (including start_code). Len = %d",
+                  packet->len);
+        return -1;                       /* error */
+    }
+    /* check the first 3 bytes are START_CODE */
+    if (packet->data[0] != 0x00 || packet->data[1] != 0x00 || packet->data[2] != 0x01) {
+        davs2_log(mgr, DAVS2_LOG_ERROR, "Invalid input Byte-Stream, not start code: %02x%02x%02x",
+                  packet->data[0], packet->data[1], packet->data[2]);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * packet->flags is only read through davs2_decoder_send_packet_flags(), the
+ * callers of davs2_decoder_send_packet() may leave it uninitialized
+ */
+static int decoder_send_packet(davs2_mgr_t *mgr, davs2_packet_t *packet, int flags)
 {
-    davs2_mgr_t *mgr = (davs2_mgr_t *)decoder;
     es_unit_t *es_unit = NULL;
     int ret_type = DAVS2_DEFAULT;
 
@@ -641,27 +1093,17 @@ davs2_decoder_send_packet(void *decoder, davs2_packet_t *packet)
     }
 #endif
 
-    /* check the input parameter: packet */
-    if (packet == NULL || packet->data == NULL || packet->len <= 0) {
-        davs2_log(mgr->decoders, DAVS2_LOG_DEBUG, "Null input packet");
-        return DAVS2_ERROR;              /* error */
+    if (decoder_check_packet(mgr, packet) < 0) {
+        return DAVS2_ERROR;
     }
 
-    /* check packet length */
-    if (packet->len < 4) {
-        davs2_log(mgr, DAVS2_LOG_DEBUG, "Invalid packet, 4 bytes are needed for one packet (including start_code). Len = %d",
-                  packet->len);
-        return DAVS2_ERROR;              /* error */
-    }
-    /* check the first 3 bytes are START_CODE */
-    if (packet->data[0] != 0x00 || packet->data[1] != 0x00 || packet->data[2] != 0x01) {
-        davs2_log(mgr, DAVS2_LOG_ERROR, "Invalid input Byte-Stream, not start code: %02x%02x%02x",
-                  packet->data[0], packet->data[1], packet->data[2]);
-        return DAVS2_ERROR;
+    if (mgr->param.non_blocking && davs2_packet_ends_es_unit(mgr, packet->data, packet->len) &&
+        !task_has_free_tasks(mgr, 1)) {
+        return DAVS2_AGAIN;
     }
 
     /* generate one es_unit for current byte-stream buffer */
-    es_unit = davs2_pack_es_unit(mgr, packet->data, packet->len, packet->pts, packet->dts);
+    es_unit = davs2_pack_es_unit(mgr, packet->data, packet->len, packet->pts, packet->dts, flags);
     if (es_unit == NULL && mgr->es_unit == NULL) {
         davs2_log(mgr, DAVS2_LOG_ERROR, "Failed to create an ES_UNIT, input Byte-Stream length %d",
                   packet->len);
@@ -686,6 +1128,68 @@ davs2_decoder_send_packet(void *decoder, davs2_packet_t *packet)
     return ret_type;
 }
 
+/* ---------------------------------------------------------------------------
+ */
+DAVS2_API int
+davs2_decoder_send_packet(void *decoder, davs2_packet_t *packet)
+{
+    return decoder_send_packet((davs2_mgr_t *)decoder, packet, 0);
+}
+
+/* ---------------------------------------------------------------------------
+ */
+DAVS2_API int
+davs2_decoder_send_packet_flags(void *decoder, davs2_packet_t *packet)
+{
+    return decoder_send_packet((davs2_mgr_t *)decoder, packet, packet != NULL ? packet->flags : 0);
+}
+
+/* ---------------------------------------------------------------------------
+ */
+DAVS2_API int
+davs2_decoder_send_packet_borrowed(void *decoder, davs2_packet_t *packet, davs2_packet_release_t release, void *opaque)
+{
+    davs2_mgr_t *mgr = (davs2_mgr_t *)decoder;
+    es_unit_t *es_unit = NULL;
+
+    if (decoder_check_packet(mgr, packet) < 0) {
+        goto fail;
+    }
+
+    if (mgr->param.non_blocking &&
+        !task_has_free_tasks(mgr, (mgr->es_unit != NULL && mgr->es_unit->len >= 4) ? 2 : 1)) {
+        return DAVS2_AGAIN;     /* the buffer is not released, it should be sent again */
+    }
+
+    /* decode the byte stream buffered by davs2_decoder_send_packet() first */
+    if (mgr->es_unit != NULL && mgr->es_unit->len >= 4) {
+        es_unit = mgr->es_unit;
+        mgr->es_unit = NULL;
+        mgr->num_frames_to_output += decoder_decode_es_unit(mgr, es_unit);
+    }
+
+    /* wrap the lent buffer into an es_unit, the data stays in place */
+    es_unit = (es_unit_t *)xl_remove_head(&mgr->packets_idle, 1);
+    es_unit->borrowed       = (uint8_t *)packet->data;
+    es_unit->release        = release;
+    es_unit->release_opaque = opaque;
+    es_unit->len = bs_dispose_pseudo_code(es_unit->borrowed, es_unit->borrowed, packet->len);
+    es_unit->pts = packet->pts;
+    es_unit->dts = packet->dts;
+    es_unit->flags = 0;     /* packet->flags is not read here */
+
+    /* decode one frame */
+    mgr->num_frames_to_output += decoder_decode_es_unit(mgr, es_unit);
+
+    return DAVS2_DEFAULT;
+
+fail:
+    if (release != NULL && packet != NULL && packet->data != NULL) {
+        release(opaque, packet->data);
+    }
+    return DAVS2_ERROR;
+}
+
 
 /* ---------------------------------------------------------------------------
  */
@@ -782,12 +1286,31 @@ davs2_decoder_close(void *decoder)
     }
 
     /* signal all decoding threads and the output thread to exit */
+    davs2_thread_mutex_lock(&mgr->mutex_mgr);
     mgr->b_exit = 1;
+    davs2_thread_cond_broadcast(&mgr->cond_task);
+    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
 
     /* destroy thread pool */
-    if (mgr->num_total_thread != 0) {
+    if (mgr->thread_pool != NULL && (mgr->param.thread_pool != NULL || mgr->rec_pool != NULL)) {
+        /* the shared pool lives on and the reconstruction outlives the parsing job,
+         * wait for the pictures of this decoder (a task is freed at the end of its job)
+         * and for the slice parsing jobs of the last picture still leaving the pool */
+        davs2_thread_mutex_lock(&mgr->mutex_mgr);
+        while (mgr->num_free_tasks < mgr->num_decoders || davs2_atomic_load(&mgr->num_slice_jobs) > 0) {
+            davs2_thread_cond_wait(&mgr->cond_task, &mgr->mutex_mgr);
+        }
+        davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+    }
+    if (mgr->param.thread_pool == NULL && mgr->thread_pool != NULL) {
         davs2_threadpool_delete((davs2_threadpool_t *)mgr->thread_pool);
     }
+    if (mgr->rec_pool != NULL) {
+        davs2_threadpool_delete((davs2_threadpool_t *)mgr->rec_pool);
+    }
+    if (mgr->flt_pool != NULL) {
+        davs2_threadpool_delete((davs2_threadpool_t *)mgr->flt_pool);
+    }
 
     /* close every task */
     for (i = 0; i < mgr->num_decoders; i++) {
@@ -802,7 +1325,9 @@ davs2_decoder_close(void *decoder)
 
     /* destroy the mutex */
     davs2_thread_mutex_destroy(&mgr->mutex_mgr);
-    davs2_thread_mutex_destroy(&mgr->mutex_aec);
+    davs2_thread_mutex_destroy(&mgr->mutex_output);
+    davs2_thread_cond_destroy(&mgr->cond_output);
+    davs2_thread_cond_destroy(&mgr->cond_task);
 
     /* free memory */
     davs2_free(mgr);          /* free the mgr */
@@ -818,3 +1343,36 @@ davs2_decoder_close(void *decoder)
     }
 #endif
 }
+
+/* ---------------------------------------------------------------------------
+ */
+DAVS2_API void *
+davs2_thread_pool_open(int threads)
+{
+    davs2_threadpool_t *pool = NULL;
+
+    if (threads <= 0) {
+        threads = davs2_cpu_num_processors();
+    }
+    if (threads > AVS2_THREAD_MAX) {
+        threads = AVS2_THREAD_MAX;
+        davs2_log(NULL, DAVS2_LOG_WARNING, "Max number of thread reached, forcing to be %d\n", AVS2_THREAD_MAX);
+    }
+
+    if (davs2_threadpool_init(&pool, threads, NULL, NULL, 0) < 0) {
+        davs2_log(NULL, DAVS2_LOG_ERROR, "failed to create the thread pool\n");
+        return NULL;
+    }
+
+    return pool;
+}
+
+/* ---------------------------------------------------------------------------
+ */
+DAVS2_API void
+davs2_thread_pool_close(void *thread_pool)
+{
+    if (thread_pool != NULL) {
+        davs2_threadpool_delete((davs2_threadpool_t *)thread_pool);
+    }
+}
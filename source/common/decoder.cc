@@ -71,8 +71,9 @@ static void init_frame(davs2_t *h)
 
     h->lcu.i_scu_xy        = 0;
     h->i_slice_index       = -1;
+    h->i_slice_spu_y       = 0;
+    h->i_slice_job         = -1;
     h->b_slice_checked     = 0;
-    h->fdec->i_parsed_lcu_xy = -1;
     h->decoding_error      = 0;    // ־
 
     /* 1, clear intra_mode buffer, set to default value (-1) */
@@ -109,11 +110,6 @@ static void init_frame(davs2_t *h)
 
     /* 6, clear the p_deblock_flag buffer */
     gf_davs2.fast_memzero(h->p_deblock_flag[0], h->i_width_in_scu * h->i_height_in_scu * 2 * sizeof(uint8_t));
-
-    /* 7, clear LCU info buffer */
-#if CTRL_AEC_THREAD
-    gf_davs2.fast_memzero(h->lcu_infos, sizeof(lcu_info_t) * h->i_width_in_lcu * h->i_height_in_lcu);
-#endif
 }
 
 
@@ -214,8 +210,9 @@ static davs2_outpic_t *get_one_free_picture(davs2_mgr_t *mgr, int w, int h)
     }
 
     if (pic == NULL) {
-        /* no free picture. no wait, just new one. */
-        pic = alloc_picture(w, h);
+        /* no free picture. no wait, just new one.
+         * (no planes for frames in buffers of the application, which are output without copy) */
+        pic = alloc_picture(w, h, mgr->param.get_buffer == NULL);
     }
 
     return pic;
@@ -227,17 +224,27 @@ static davs2_outpic_t *get_one_free_picture(davs2_mgr_t *mgr, int w, int h)
 static ALWAYS_INLINE
 void wait_lcu_row_parsed(davs2_t *h, davs2_frame_t *frm, int lcu_xy)
 {
-    UNUSED_PARAMETER(h);
+    if (lcu_xy > davs2_atomic_load(&frm->i_parsed_lcu_xy)) {
+        int64_t t0 = davs2_get_us();
 
-    if (lcu_xy > frm->i_parsed_lcu_xy) {
-        davs2_thread_mutex_lock(&frm->mutex_frm);   /* lock */
-        while (lcu_xy > frm->i_parsed_lcu_xy) {
-            davs2_thread_cond_wait(&frm->cond_aec, &frm->mutex_frm);
-        }
-        davs2_thread_mutex_unlock(&frm->mutex_frm); /* unlock */
+        davs2_frame_wait_parsed(frm, lcu_xy);
+        /* the parsers are short of threads (see task_adapt_frame_parallelism) */
+        davs2_atomic_fetch_add(&h->task_info.taskmgr->wait_parse_us, (int)(davs2_get_us() - t0));
     }
 }
 
+/* ---------------------------------------------------------------------------
+ * mark the LCUs up to lcu_xy as parsed and wake up the reconstruction
+ */
+static ALWAYS_INLINE
+void signal_lcu_parsed(davs2_t *h, davs2_frame_t *frm, int lcu_xy)
+{
+    UNUSED_PARAMETER(h);
+
+    /* wakes up the reconstruction only when it waits for one of these LCUs */
+    davs2_frame_set_parsed(frm, lcu_xy);
+}
+
 /* ---------------------------------------------------------------------------
  * ȴһLCUعָLCU
  */
@@ -247,12 +254,58 @@ void wait_lcu_row_reconed(davs2_t *h, davs2_frame_t *frm, int wait_lcu_y, int wa
     UNUSED_PARAMETER(h);
     // wait_lcu_coded = DAVS2_MIN(h->i_width_in_lcu, wait_lcu_coded);
 
-    if (frm->num_decoded_lcu_in_row[wait_lcu_y] < wait_lcu_coded) {
-        davs2_thread_mutex_lock(&frm->mutex_recon);   /* lock */
-        while (frm->num_decoded_lcu_in_row[wait_lcu_y] < wait_lcu_coded) {
-            davs2_thread_cond_wait(&frm->conds_lcu_row[wait_lcu_y], &frm->mutex_recon);
+    if (davs2_atomic_load(&frm->num_decoded_lcu_in_row[wait_lcu_y]) < wait_lcu_coded) {
+        davs2_frame_wait_lcu_row(frm, wait_lcu_y, wait_lcu_coded);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * mark the LCUs up to lcu_xy as parsed. when the slices are parsed in parallel,
+ * only the first slice not parsed completely reports its LCUs, its end reports
+ * the slices parsed meanwhile (see decode_slice_parsed)
+ */
+static ALWAYS_INLINE
+void report_lcu_parsed(davs2_t *h, int lcu_xy)
+{
+    if (h->i_slice_job < 0 || davs2_atomic_load(&h->p_slices->i_frontier) == h->i_slice_job) {
+        signal_lcu_parsed(h, h->fdec, lcu_xy);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * marks the LCUs from lcu_xy up to lcu_end (excluded) as not parsed after an
+ * error, the reconstruction skips their CUs and flags the frame (pipeline)
+ */
+static void invalidate_lcus(davs2_t *h, int lcu_xy, int lcu_end)
+{
+    const int scu_shift = h->i_lcu_level - MIN_CU_SIZE_IN_BIT;
+
+    for (; lcu_xy < lcu_end; lcu_xy++) {
+        int scu_x0 = (lcu_xy % h->i_width_in_lcu) << scu_shift;
+        int scu_y0 = (lcu_xy / h->i_width_in_lcu) << scu_shift;
+        int scu_x1 = DAVS2_MIN(scu_x0 + (1 << scu_shift), h->i_width_in_scu);
+        int scu_y1 = DAVS2_MIN(scu_y0 + (1 << scu_shift), h->i_height_in_scu);
+        int scu_x, scu_y;
+
+        for (scu_y = scu_y0; scu_y < scu_y1; scu_y++) {
+            cu_t *p_cu = &h->scu_data[scu_y * h->i_width_in_scu];
+            for (scu_x = scu_x0; scu_x < scu_x1; scu_x++) {
+                p_cu[scu_x].i_slice_nr = -1;
+            }
         }
-        davs2_thread_mutex_unlock(&frm->mutex_recon); /* unlock */
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * wait until the reconstruction releases the ring buffer for the coefficients of an LCU
+ */
+static void wait_rec_ring_slot(davs2_t *h, int lcu_xy)
+{
+    /* the slot was used by the LCU one ring length before */
+    int lcu_prev = lcu_xy - h->num_rec_ring;
+
+    if (lcu_prev >= 0) {
+        wait_lcu_row_reconed(h, h->fdec, lcu_prev / h->i_width_in_lcu, lcu_prev % h->i_width_in_lcu + 1);
     }
 }
 
@@ -261,15 +314,60 @@ void wait_lcu_row_reconed(davs2_t *h, davs2_frame_t *frm, int wait_lcu_y, int wa
 static void decoder_signal(davs2_t *h, davs2_frame_t *frame, int line)
 {
     if (line > 0) {
-        wait_lcu_row_reconed(h, frame, line - 1, h->i_width_in_lcu + 1);
+        wait_lcu_row_reconed(h, frame, line - 1, LCU_ROW_FINISHED(h->i_width_in_lcu));
+    }
+
+    frame->i_decoded_line = line;
+    davs2_frame_set_lcu_row(frame, line, LCU_ROW_FINISHED(h->i_width_in_lcu));
+}
+
+/* ---------------------------------------------------------------------------
+ * report the lines of the decoding frame which are final after LCU row 'line' is filtered
+ */
+static void decoder_report_rows(davs2_t *h, davs2_frame_t *frame, int line)
+{
+    davs2_mgr_t *mgr = h->task_info.taskmgr;
+    davs2_picture_t pic;
+    int num_lines;
+
+    if (mgr->rows_callback == NULL) {
+        return;
     }
 
-    davs2_thread_mutex_lock(&frame->mutex_recon);
-    frame->i_decoded_line++;
-    frame->num_decoded_lcu_in_row[line] = h->i_width_in_lcu + 3;
-    davs2_thread_mutex_unlock(&frame->mutex_recon);
+    if (line == h->i_height_in_lcu - 1) {
+        num_lines = h->i_image_height;
+    } else {
+        /* deblock, SAO and ALF of the next row still modify the lines above its
+         * top edge, by up to SAO_SHIFT_PIX_NUM chroma lines */
+        num_lines = ((line + 1) << h->i_lcu_level) - (SAO_SHIFT_PIX_NUM << 1);
+        num_lines = DAVS2_MIN(num_lines, h->i_image_height);
+    }
 
-    davs2_thread_cond_broadcast(&frame->conds_lcu_row[line]);
+    memset(&pic, 0, sizeof(pic));
+    pic.planes[0]        = (uint8_t *)frame->planes[0];
+    pic.planes[1]        = (uint8_t *)frame->planes[1];
+    pic.planes[2]        = (uint8_t *)frame->planes[2];
+    pic.strides[0]       = frame->i_stride[0] * sizeof(pel_t);
+    pic.strides[1]       = frame->i_stride[1] * sizeof(pel_t);
+    pic.strides[2]       = frame->i_stride[2] * sizeof(pel_t);
+    pic.widths[0]        = h->i_image_width;
+    pic.widths[1]        = h->i_image_width / 2;
+    pic.widths[2]        = h->i_image_width / 2;
+    pic.lines[0]         = h->i_image_height;
+    pic.lines[1]         = h->i_image_height / (h->i_chroma_format == CHROMA_420 ? 2 : 1);
+    pic.lines[2]         = pic.lines[1];
+    pic.num_planes       = (h->i_chroma_format != CHROMA_400) ? 3 : 1;
+    pic.bytes_per_sample = sizeof(pel_t);
+    pic.bit_depth        = h->sample_bit_depth;
+    pic.b_decode_error   = h->decoding_error;
+    pic.type             = frame->i_type;
+    pic.qp               = frame->i_qp;
+    pic.pts              = frame->i_pts;
+    pic.dts              = frame->i_dts;
+    pic.pic_order_count  = frame->i_poc;
+    pic.buf_opaque       = frame->ext_buf.buf_opaque;
+
+    mgr->rows_callback(mgr->rows_callback_opaque, &pic, num_lines);
 }
 
 /* ---------------------------------------------------------------------------
@@ -304,11 +402,20 @@ void task_send_picture_to_output_list(davs2_t *h, davs2_outpic_t *pic)
         mgr->outpics.pics = pic;
     }
     mgr->outpics.num_output_pic++;
+    mgr->outpics.num_inserted++;
 
     DAVS2_ASSERT(h->task_info.task_status == TASK_BUSY,
         "Invalid task status %d",
         h->task_info.task_status);
+
+    /* wake up the output */
+    davs2_thread_cond_broadcast(&mgr->cond_output);
     davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+
+    /* hand out the frames ready for output at once */
+    if (mgr->frame_callback != NULL) {
+        decoder_deliver_output(mgr, 0);
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -363,9 +470,9 @@ int check_slice_header(davs2_t *h, davs2_bs_t *bs, int lcu_y)
         aec_start_decoding(p_aec, bs->p_stream, ((bs->i_bit_pos + 7) / 8), bs->i_stream);
         AEC_RETURN_ON_ERROR(-1);
 
-        /* ǰSliceһеԤģʽ */
-        lcu_y <<= (h->i_lcu_level - MIN_PU_SIZE_IN_BIT);
-        memset(h->p_ipredmode + (lcu_y - 1) * h->i_ipredmode - 16, DC_PRED, h->i_ipredmode * sizeof(int8_t));
+        /* the intra prediction modes above the slice are not used, the slice
+         * above may still be parsed (slice-parallel parsing) */
+        h->i_slice_spu_y = lcu_y << (h->i_lcu_level - MIN_PU_SIZE_IN_BIT);
     }
 
     return 0;
@@ -391,6 +498,38 @@ void rowrec_store_lcu_recon_samples(davs2_row_rec_t *row_rec)
 #endif
 }
 
+/* ---------------------------------------------------------------------------
+ * SAO and ALF of a deblocked LCU row. the frames referencing this one may use
+ * the LCUs on the left as soon as they are final
+ */
+static void decode_lcu_row_sao_alf(davs2_t *h, int i_lcu_y)
+{
+    const int width_in_lcu = h->i_width_in_lcu;
+    int alf_enable         = h->pic_alf_on[0] | h->pic_alf_on[1] | h->pic_alf_on[2];
+    int i_lcu_x;
+
+    /* SAO current lcu-row */
+    if (h->b_sao) {
+        davs2_frame_copy_lcurow(h, h->p_frame_sao, h->fdec, i_lcu_y, -4, 0);
+        for (i_lcu_x = 0; i_lcu_x < width_in_lcu; i_lcu_x++) {
+            sao_lcu_block(h, h->p_frame_sao, h->fdec, i_lcu_x, i_lcu_y);
+            /* SAO of an LCU modifies the right columns of the LCU on the left */
+            if (!alf_enable && i_lcu_x > 0) {
+                davs2_frame_set_lcu_row(h->fdec, i_lcu_y, LCU_ROW_FILTERED(width_in_lcu, i_lcu_x));
+            }
+        }
+    }
+
+    /* ALF current lcu-row */
+    if (alf_enable) {
+        davs2_frame_copy_lcurow(h, h->p_frame_alf, h->fdec, i_lcu_y, -4, 8);
+        for (i_lcu_x = 0; i_lcu_x < width_in_lcu; i_lcu_x++) {
+            alf_lcu_block(h, h->p_alf->img_param, h->p_frame_alf, h->fdec, i_lcu_x, i_lcu_y);
+            davs2_frame_set_lcu_row(h->fdec, i_lcu_y, LCU_ROW_FILTERED(width_in_lcu, i_lcu_x + 1));
+        }
+    }
+}
+
 /* ---------------------------------------------------------------------------
  * decodes one LCU row
  */
@@ -398,7 +537,6 @@ static int decode_one_lcu_row(davs2_t *h, davs2_bs_t *bs, int i_lcu_y)
 {
     const int height_in_lcu = h->i_height_in_lcu;
     const int width_in_lcu  = h->i_width_in_lcu;
-    int alf_enable          = h->pic_alf_on[0] | h->pic_alf_on[1] | h->pic_alf_on[2];
     int lcu_xy              = i_lcu_y * width_in_lcu;
     int i_lcu_x;
     int i;
@@ -415,6 +553,7 @@ static int decode_one_lcu_row(davs2_t *h, davs2_bs_t *bs, int i_lcu_y)
         avs2_trace("\n*********** Pic: %i (I/P) MB: %i Slice: %i Type %d **********\n", h->i_poc, h->lcu.i_scu_xy, h->i_slice_index, h->i_frame_type);
 #endif
         h->lcu.lcu_aec = row_rec.lcu_info = &h->lcu_infos[lcu_xy];
+        h->lcu.p_rec_aec = &h->lcu.rec_info;
 
         rowrec_lcu_init(h, &row_rec, i_lcu_x, i_lcu_y);
         decode_lcu_init(h, i_lcu_x, i_lcu_y);
@@ -476,15 +615,7 @@ static int decode_one_lcu_row(davs2_t *h, davs2_bs_t *bs, int i_lcu_y)
     if (h->decoding_error != 0) {
         
     } else {
-        /* SAO current lcu-row */
-        if (h->b_sao) {
-            sao_lcurow(h, h->p_frame_sao, h->fdec, i_lcu_y);
-        }
-
-        /* ALF current lcu-row */
-        if (alf_enable) {
-            alf_lcurow(h, h->p_alf->img_param, h->p_frame_alf, h->fdec, i_lcu_y);
-        }
+        decode_lcu_row_sao_alf(h, i_lcu_y);
     }
 
     /* save motion vectors for reference frame */
@@ -500,6 +631,8 @@ static int decode_one_lcu_row(davs2_t *h, davs2_bs_t *bs, int i_lcu_y)
         decoder_signal(h, h->fdec, i_lcu_y);
     }
 
+    decoder_report_rows(h, h->fdec, i_lcu_y);
+
     if (i_lcu_y == height_in_lcu - 1) {
 
         /* init for AVS-S */
@@ -522,18 +655,14 @@ static int decode_one_lcu_row(davs2_t *h, davs2_bs_t *bs, int i_lcu_y)
         task_release_frames(h);
         /* task is free */
         task_unload_packet(h, h->task_info.curr_es_unit);
-
-        // davs2_thread_mutex_lock(&h->task_info.taskmgr->mutex_aec);
-        // h->task_info.taskmgr->num_active_decoders--;
-        // davs2_thread_mutex_unlock(&h->task_info.taskmgr->mutex_aec);
     }
 
     return 0;
 }
 
-// #if CTRL_AEC_THREAD
 /* ---------------------------------------------------------------------------
- * decodes one LCU row
+ * parses one LCU row (pipeline), the coefficients are handed over to the
+ * reconstruction through the ring buffer
  */
 static int decode_one_lcu_row_parse(davs2_t *h, davs2_bs_t *bs, int i_lcu_y)
 {
@@ -546,13 +675,19 @@ static int decode_one_lcu_row_parse(davs2_t *h, davs2_bs_t *bs, int i_lcu_y)
      */
     for (i_lcu_x = 0; i_lcu_x < width_in_lcu; i_lcu_x++, lcu_xy++) {
         if (check_slice_header(h, bs, i_lcu_y) < 0) {
+            /* let the reconstruction pass the rest of this row, the ring
+             * still holds the coefficients of older LCUs */
+            invalidate_lcus(h, lcu_xy, lcu_xy + width_in_lcu - i_lcu_x);
+            report_lcu_parsed(h, lcu_xy + width_in_lcu - i_lcu_x - 1);
             return -1;
         }
 
 #if AVS2_TRACE
         avs2_trace("\n*********** Pic: %i (I/P) MB: %i Slice: %i Type %d **********\n", h->i_poc, h->lcu.i_scu_xy, h->i_slice_index, h->i_frame_type);
 #endif
-        h->lcu.lcu_aec = &h->lcu_infos[lcu_xy];
+        wait_rec_ring_slot(h, lcu_xy);
+        h->lcu.lcu_aec   = &h->lcu_infos[lcu_xy];
+        h->lcu.p_rec_aec = &h->rec_ring[lcu_xy % h->num_rec_ring];
         decode_lcu_init(h, i_lcu_x, i_lcu_y);
 
         /* decode LCU level data before one LCU */
@@ -578,158 +713,253 @@ static int decode_one_lcu_row_parse(davs2_t *h, davs2_bs_t *bs, int i_lcu_y)
         h->b_slice_checked = (bool_t)aec_startcode_follows(&h->aec, 1);
         bs->i_bit_pos      = aec_bits_read(&h->aec);
 
-        h->fdec->i_parsed_lcu_xy = lcu_xy;
-        davs2_thread_cond_broadcast(&h->fdec->cond_aec);
-    }
+        /* save motion vectors for reference frame before the last LCU is
+         * released, the filter threads may finish the row right after it */
+        if (i_lcu_x == width_in_lcu - 1 && h->rps.refered_by_others && h->i_frame_type != AVS2_I_SLICE) {
+            save_mv_ref_info(h, i_lcu_y);
+        }
 
-    /* save motion vectors for reference frame */
-    if (h->rps.refered_by_others && h->i_frame_type != AVS2_I_SLICE) {
-        save_mv_ref_info(h, i_lcu_y);
+        report_lcu_parsed(h, lcu_xy);
     }
 
     return 0;
 }
 
 /* ---------------------------------------------------------------------------
- * decodes one LCU row
+ * finishes a frame without picture data
  */
-static int decode_lcu_row_recon(davs2_t *h, int i_lcu_y)
+static void decode_finish_empty_frame(davs2_t *h)
 {
-    const int width_in_lcu  = h->i_width_in_lcu;
-    const int height_in_lcu = h->i_height_in_lcu;
-    int alf_enable          = h->pic_alf_on[0] | h->pic_alf_on[1] | h->pic_alf_on[2];
-    int i_lcu_level         = h->i_lcu_level;
-    int lcu_xy              = i_lcu_y * h->i_width_in_lcu;
-    int b_recon_finish      = 0;
-    int b_next_row_launched = 0;
-    davs2_row_rec_t row_rec;
+    ///!!! make sure that all row signals of frames with 'b_refered_by_others == 1' have been set before return.
+    /// use 'goto fail' instead of 'return' in the half way.
+    if (h->rps.refered_by_others) {
+        // set all row signals before returning.
+        int lcu_y;
+        for (lcu_y = 0; lcu_y < h->i_height_in_lcu; ++lcu_y) {
+            decoder_signal(h, h->fdec, lcu_y);
+        }
+    }
 
-    while (i_lcu_y < height_in_lcu) {
-        /* loop over all LCUs in current LCU row ------------------------
-         */
-        int i_lcu_x;
-        for (i_lcu_x = 0; i_lcu_x < width_in_lcu; i_lcu_x++, lcu_xy++) {
-            /* wait until the parsing process of current LCU having finished */
-            wait_lcu_row_parsed(h, h->fdec, lcu_xy);
+    if (h->i_frame_type == AVS2_G_SLICE) {
+        davs2_frame_copy_planes(h->f_background_ref, h->fdec);
+    }
 
-            if (i_lcu_y > 0) {
-                wait_lcu_row_reconed(h, h->fdec, i_lcu_y - 1, DAVS2_MIN(i_lcu_x + 2, h->i_width_in_lcu));
-            }
-            row_rec.lcu_info = &h->lcu_infos[lcu_xy];
-#if CTRL_AEC_THREAD
-            row_rec.p_rec_info = &row_rec.lcu_info->rec_info;
-#endif
-            rowrec_lcu_init(h, &row_rec, i_lcu_x, i_lcu_y);
+    /* task is free */
+    task_unload_packet(h, h->task_info.curr_es_unit);
+}
 
-            /* cache CTU top border for intra prediction */
-            if (i_lcu_x == 0) {
-                memcpy(row_rec.ctu_border[0].rec_top + 1, h->intra_border[0], row_rec.ctu.i_ctu_w * 2 * sizeof(pel_t));
-                memcpy(row_rec.ctu_border[1].rec_top + 1, h->intra_border[1], row_rec.ctu.i_ctu_w * sizeof(pel_t));
-                memcpy(row_rec.ctu_border[2].rec_top + 1, h->intra_border[2], row_rec.ctu.i_ctu_w * sizeof(pel_t));
-            }
+/* ---------------------------------------------------------------------------
+ * in-loop filters and padding of a reconstructed LCU row (pipeline), the rows
+ * are filtered in order
+ */
+static void decode_lcu_row_filter(davs2_t *h, int i_lcu_y)
+{
+    if (i_lcu_y > 0) {
+        wait_lcu_row_reconed(h, h->fdec, i_lcu_y - 1, LCU_ROW_FINISHED(h->i_width_in_lcu));
+    }
 
-            decode_lcu_recon(h, &row_rec, i_lcu_level, i_lcu_x << i_lcu_level, i_lcu_y << i_lcu_level);
-
-            rowrec_store_lcu_recon_samples(&row_rec);
-            /* cache top and left samples for intra prediction of next CTU */
-            davs2_cache_lcu_border(row_rec.ctu_border[0].rec_top, h->intra_border[0] + row_rec.ctu.i_pix_x + row_rec.ctu.i_ctu_w - 1,
-                                   row_rec.ctu.p_frec[0] + row_rec.ctu.i_ctu_w - 1,
-                                   row_rec.ctu.i_frec[0], row_rec.ctu.i_ctu_w, row_rec.ctu.i_ctu_h);
-            davs2_cache_lcu_border_uv(row_rec.ctu_border[1].rec_top, h->intra_border[1] + row_rec.ctu.i_pix_x_c + row_rec.ctu.i_ctu_w_c - 1, row_rec.ctu.p_frec[1] + row_rec.ctu.i_ctu_w_c - 1,
-                                      row_rec.ctu_border[2].rec_top, h->intra_border[2] + row_rec.ctu.i_pix_x_c + row_rec.ctu.i_ctu_w_c - 1, row_rec.ctu.p_frec[2] + row_rec.ctu.i_ctu_w_c - 1,
-                                      row_rec.ctu.i_frec[1], row_rec.ctu.i_ctu_w_c, row_rec.ctu.i_ctu_h_c);
-
-            /* backup bottom row pixels */
-            if (i_lcu_y < h->i_height_in_lcu - 1) {
-                memcpy(h->intra_border[0] + row_rec.ctu.i_pix_x, row_rec.ctu.p_frec[0] + (row_rec.ctu.i_ctu_h - 1) * h->fdec->i_stride[0], row_rec.ctu.i_ctu_w   * sizeof(pel_t));
-                memcpy(h->intra_border[1] + row_rec.ctu.i_pix_x_c, row_rec.ctu.p_frec[1] + (row_rec.ctu.i_ctu_h_c - 1) * h->fdec->i_stride[1], row_rec.ctu.i_ctu_w_c * sizeof(pel_t));
-                memcpy(h->intra_border[2] + row_rec.ctu.i_pix_x_c, row_rec.ctu.p_frec[2] + (row_rec.ctu.i_ctu_h_c - 1) * h->fdec->i_stride[1], row_rec.ctu.i_ctu_w_c * sizeof(pel_t));
-            }
+    decode_lcu_row_sao_alf(h, i_lcu_y);
 
-            /* deblock one lcu */
-            if (h->b_loop_filter) {
-                davs2_lcu_deblock(h, h->fdec, i_lcu_x, i_lcu_y);
-            }
+    /* frame padding : line by line */
+    if (h->rps.refered_by_others) {
+        pad_line_lcu(h, i_lcu_y);
+    }
 
-            h->fdec->num_decoded_lcu_in_row[i_lcu_y]++;
+    /* report before the signal, so that the rows are reported in order */
+    decoder_report_rows(h, h->fdec, i_lcu_y);
+
+    /* wake up all waiting threads */
+    decoder_signal(h, h->fdec, i_lcu_y);
+}
+
+/* ---------------------------------------------------------------------------
+ * finishes a frame after all LCU rows are reconstructed and filtered (pipeline)
+ */
+static void decode_finish_frame(davs2_t *h)
+{
+    /* init for AVS-S */
+    if ((h->i_frame_type == AVS2_P_SLICE || h->i_frame_type == AVS2_F_SLICE) && h->b_bkgnd_picture && h->b_bkgnd_reference) {
+        const int w_in_spu = h->i_width_in_spu;
+        const int h_in_spu = h->i_height_in_spu;
+        int x, y;
+
+        for (y = 0; y < h_in_spu; y++) {
+            for (x = 0; x < w_in_spu; x++) {
+                int refframe = h->p_ref_idx[y * w_in_spu + x].r[0];
+                if (refframe == h->num_of_references - 1) {
+                    h->p_ref_idx[y * w_in_spu + x].r[0] = INVALID_REF;
+                }
+            }
         }
+    }
 
+    // davs2_log(h, DAVS2_LOG_INFO, "POC %3d reconstruction finished.", h->i_poc);
+    if (h->i_frame_type == AVS2_G_SLICE) {
+        davs2_frame_copy_planes(h->f_background_ref, h->fdec);
+    }
 
-        /* SAO above lcu-row */
-        if (h->b_sao && i_lcu_y) {
-            sao_lcurow(h, h->p_frame_sao, h->fdec, i_lcu_y - 1);  // above row
+    task_output_decoding_frame(h);
+    task_release_frames(h);
+    /* task is free */
+    task_unload_packet(h, h->task_info.curr_es_unit);
+}
 
-            if (i_lcu_y == height_in_lcu - 1) {
-                sao_lcurow(h, h->p_frame_sao, h->fdec, i_lcu_y);  // last row
+/* ---------------------------------------------------------------------------
+ * filters the reconstructed LCU rows of a frame in order (filter threads). one
+ * job at a time runs while the reconstruction hands rows over, and the job
+ * filtering the last row finishes the frame
+ */
+static int decode_lcu_rows_filter(davs2_t *h, int arg2)
+{
+    const int width_in_lcu  = h->i_width_in_lcu;
+    const int height_in_lcu = h->i_height_in_lcu;
+    int i_lcu_x;
+
+    UNUSED_PARAMETER(arg2);
+    davs2_set_thread_bit_depth(h->sample_bit_depth);
+
+    do {
+        int i_lcu_y = h->i_flt_lcu_y++;
+
+        if (!h->b_rec_no_data) {
+            /* deblock the whole row, the row below is not deblocked yet */
+            if (h->b_loop_filter) {
+                for (i_lcu_x = 0; i_lcu_x < width_in_lcu; i_lcu_x++) {
+                    davs2_lcu_deblock(h, h->fdec, i_lcu_x, i_lcu_y);
+                }
             }
+
+            decode_lcu_row_filter(h, i_lcu_y);
         }
 
-        /* ALF above lcu-row */
-        if (alf_enable && i_lcu_y) {
-            alf_lcurow(h, h->p_alf->img_param, h->p_frame_alf, h->fdec, i_lcu_y - 1);  // above row
-            if (i_lcu_y == height_in_lcu - 1) {
-                alf_lcurow(h, h->p_alf->img_param, h->p_frame_alf, h->fdec, i_lcu_y);  // last row
+        if (i_lcu_y == height_in_lcu - 1) {
+            /* all rows have been handed over */
+            if (h->b_rec_no_data) {
+                decode_finish_empty_frame(h);
+            } else {
+                decode_finish_frame(h);
             }
+            return 0;
         }
+    } while (davs2_atomic_fetch_add(&h->num_flt_rows_ready, -1) > 1);
+
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * reconstructs one LCU row of a frame (pipeline). the rows are reconstructed
+ * by several threads in wavefront order. each row filters the row above and
+ * the last finished row finishes the frame, unless the rows are handed over
+ * to the filter threads
+ */
+static int decode_lcu_row_recon(davs2_t *h, int i_lcu_y)
+{
+    const int width_in_lcu  = h->i_width_in_lcu;
+    const int height_in_lcu = h->i_height_in_lcu;
+    void *flt_pool          = h->task_info.taskmgr->flt_pool;
+    int i_lcu_level         = h->i_lcu_level;
+    int lcu_xy              = i_lcu_y * width_in_lcu;
+    int i_lcu_x;
+    davs2_row_rec_t row_rec;
+
+    /* wait for the parser to reach this row */
+    wait_lcu_row_parsed(h, h->fdec, lcu_xy);
+    if (h->b_rec_no_data) {
+        goto row_done;
+    }
+
+    davs2_set_thread_bit_depth(h->sample_bit_depth);
+
+    /* loop over all LCUs in current LCU row ------------------------
+     */
+    for (i_lcu_x = 0; i_lcu_x < width_in_lcu; i_lcu_x++, lcu_xy++) {
+        /* wait until the parsing process of current LCU having finished */
+        wait_lcu_row_parsed(h, h->fdec, lcu_xy);
 
         if (i_lcu_y > 0) {
-            /* frame padding : line by line */
-            if (h->rps.refered_by_others) {
-                pad_line_lcu(h, i_lcu_y - 1);
-            }
-            /* wake up all waiting threads */
-            decoder_signal(h, h->fdec, i_lcu_y - 1);
+            wait_lcu_row_reconed(h, h->fdec, i_lcu_y - 1, DAVS2_MIN(i_lcu_x + 2, width_in_lcu));
         }
+        row_rec.lcu_info = &h->lcu_infos[lcu_xy];
+        rowrec_lcu_init(h, &row_rec, i_lcu_x, i_lcu_y);
 
-        /* The last row in one frame */
-        if (i_lcu_y == height_in_lcu - 1) {
-            b_recon_finish = 1;
+        /* cache CTU top border for intra prediction */
+        if (i_lcu_x == 0) {
+            memcpy(row_rec.ctu_border[0].rec_top + 1, h->intra_border[0], row_rec.ctu.i_ctu_w * 2 * sizeof(pel_t));
+            memcpy(row_rec.ctu_border[1].rec_top + 1, h->intra_border[1], row_rec.ctu.i_ctu_w * sizeof(pel_t));
+            memcpy(row_rec.ctu_border[2].rec_top + 1, h->intra_border[2], row_rec.ctu.i_ctu_w * sizeof(pel_t));
         }
 
-        /* TODO: loop to next LCU row */
-        if (b_next_row_launched) {
-            break;
+        decode_lcu_recon(h, &row_rec, i_lcu_level, i_lcu_x << i_lcu_level, i_lcu_y << i_lcu_level);
+
+        rowrec_store_lcu_recon_samples(&row_rec);
+
+        /* the top border of the next CTU comes from two CTUs ahead in the row above */
+        if (i_lcu_y > 0) {
+            wait_lcu_row_reconed(h, h->fdec, i_lcu_y - 1, DAVS2_MIN(i_lcu_x + 3, width_in_lcu));
         }
-        i_lcu_y++;
-    }
+        /* cache top and left samples for intra prediction of next CTU */
+        davs2_cache_lcu_border(row_rec.ctu_border[0].rec_top, h->intra_border[0] + row_rec.ctu.i_pix_x + row_rec.ctu.i_ctu_w - 1,
+                               row_rec.ctu.p_frec[0] + row_rec.ctu.i_ctu_w - 1,
+                               row_rec.ctu.i_frec[0], row_rec.ctu.i_ctu_w, row_rec.ctu.i_ctu_h);
+        davs2_cache_lcu_border_uv(row_rec.ctu_border[1].rec_top, h->intra_border[1] + row_rec.ctu.i_pix_x_c + row_rec.ctu.i_ctu_w_c - 1, row_rec.ctu.p_frec[1] + row_rec.ctu.i_ctu_w_c - 1,
+                                  row_rec.ctu_border[2].rec_top, h->intra_border[2] + row_rec.ctu.i_pix_x_c + row_rec.ctu.i_ctu_w_c - 1, row_rec.ctu.p_frec[2] + row_rec.ctu.i_ctu_w_c - 1,
+                                  row_rec.ctu.i_frec[1], row_rec.ctu.i_ctu_w_c, row_rec.ctu.i_ctu_h_c);
 
-    /* the bottom LCU row in a frame */
-    if (b_recon_finish) {
-        if (h->rps.refered_by_others) {
-            pad_line_lcu(h, h->i_height_in_lcu - 1);
+        /* backup bottom row pixels */
+        if (i_lcu_y < height_in_lcu - 1) {
+            memcpy(h->intra_border[0] + row_rec.ctu.i_pix_x, row_rec.ctu.p_frec[0] + (row_rec.ctu.i_ctu_h - 1) * h->fdec->i_stride[0], row_rec.ctu.i_ctu_w   * sizeof(pel_t));
+            memcpy(h->intra_border[1] + row_rec.ctu.i_pix_x_c, row_rec.ctu.p_frec[1] + (row_rec.ctu.i_ctu_h_c - 1) * h->fdec->i_stride[1], row_rec.ctu.i_ctu_w_c * sizeof(pel_t));
+            memcpy(h->intra_border[2] + row_rec.ctu.i_pix_x_c, row_rec.ctu.p_frec[2] + (row_rec.ctu.i_ctu_h_c - 1) * h->fdec->i_stride[1], row_rec.ctu.i_ctu_w_c * sizeof(pel_t));
         }
 
-        decoder_signal(h, h->fdec, h->i_height_in_lcu - 1);
-        /* init for AVS-S */
-        if ((h->i_frame_type == AVS2_P_SLICE || h->i_frame_type == AVS2_F_SLICE) && h->b_bkgnd_picture && h->b_bkgnd_reference) {
-            const int w_in_spu = h->i_width_in_spu;
-            const int h_in_spu = h->i_height_in_spu;
-            int x, y;
+        /* deblock one lcu */
+        if (h->b_loop_filter && flt_pool == NULL) {
+            davs2_lcu_deblock(h, h->fdec, i_lcu_x, i_lcu_y);
+        }
 
-            for (y = 0; y < h_in_spu; y++) {
-                for (x = 0; x < w_in_spu; x++) {
-                    int refframe = h->p_ref_idx[y * w_in_spu + x].r[0];
-                    if (refframe == h->num_of_references - 1) {
-                        h->p_ref_idx[y * w_in_spu + x].r[0] = INVALID_REF;
-                    }
-                }
-            }
+        /* wake up the row below, this also gives the coefficient buffer of
+         * this LCU back to the parser */
+        davs2_frame_set_lcu_row(h->fdec, i_lcu_y, i_lcu_x + 1);
+    }
+
+    if (flt_pool == NULL) {
+        /* the deblocking of this row has finished the row above */
+        if (i_lcu_y > 0) {
+            decode_lcu_row_filter(h, i_lcu_y - 1);
+        }
+        if (i_lcu_y == height_in_lcu - 1) {
+            /* the motion vectors of the last row are saved after the parsing */
+            wait_lcu_row_parsed(h, h->fdec, width_in_lcu * height_in_lcu);
+            decode_lcu_row_filter(h, i_lcu_y);
         }
+    } else if (i_lcu_y == height_in_lcu - 1) {
+        wait_lcu_row_parsed(h, h->fdec, width_in_lcu * height_in_lcu);
+    }
 
-        // davs2_log(h, DAVS2_LOG_INFO, "POC %3d reconstruction finished.", h->i_poc);
-        if (h->i_frame_type == AVS2_G_SLICE) {
-            davs2_frame_copy_planes(h->f_background_ref, h->fdec);
+row_done:
+    if (flt_pool != NULL) {
+        /* hand the row over to the filter threads, the rows above have been
+         * reconstructed already. the task must not be touched after this */
+        if (davs2_atomic_fetch_add(&h->num_flt_rows_ready, 1) == 0) {
+            davs2_threadpool_run((davs2_threadpool_t *)flt_pool,
+                                 (davs2_threadpool_func_t)decode_lcu_rows_filter, h, 0, h->fdec->i_job_priority, 0);
         }
+        return 0;
+    }
 
-        task_output_decoding_frame(h);
-        task_release_frames(h);
-        /* task is free */
-        task_unload_packet(h, h->task_info.curr_es_unit);
+    /* the other rows must not touch the task any more after this */
+    if (davs2_atomic_fetch_add(&h->num_rec_rows_left, -1) == 1) {
+        /* wait for the parser to finish the frame */
+        wait_lcu_row_parsed(h, h->fdec, width_in_lcu * height_in_lcu);
+        if (h->b_rec_no_data) {
+            decode_finish_empty_frame(h);
+        } else {
+            decode_finish_frame(h);
+        }
     }
 
     return 0;
 }
-// #endif  // #if CTRL_AEC_THREAD
 
 
 /* ---------------------------------------------------------------------------
@@ -763,6 +993,247 @@ static void decode_user_data(davs2_t *h, davs2_bs_t *bs)
     }
 }
 
+/* ---------------------------------------------------------------------------
+ * slice-parallel parsing: generation of the picture (8 bits), number of slices
+ * and next slice to be parsed (12 bits each) in one word, claimed by CAS
+ */
+#define SLICE_CLAIM(gen, num, next)  (((gen) << 24) | ((num) << 12) | (next))
+#define SLICE_CLAIM_GEN(claim)       (((claim) >> 24) & 0xFF)
+#define SLICE_CLAIM_NUM(claim)       (((claim) >> 12) & 0xFFF)
+#define SLICE_CLAIM_NEXT(claim)      ((claim) & 0xFFF)
+
+/* ---------------------------------------------------------------------------
+ * locates the slices of the picture data (slice-parallel parsing). returns the
+ * number of slices, 0 if they are not parsed in parallel: a single slice, or
+ * slices not starting at the left edge of an LCU row in order
+ */
+static int decode_find_slices(davs2_t *h, davs2_bs_t *bs)
+{
+    davs2_slice_t *slices = h->p_slices->slices;
+    int      bytes = bs->i_bit_pos >> 3;
+    int      left  = bs->i_stream - bytes;
+    uint8_t *data  = bs->p_stream + bytes;
+    int num_slices = 0;
+
+    while (left >= 4) {
+        if (data[0] == 0 && data[1] == 0 && data[2] == 1) {
+            if (data[3] <= SC_SLICE_CODE_MAX) {
+                davs2_bs_t bs_slice;
+                int lcu_x, lcu_y;
+
+                if (left < 8 || num_slices == h->i_height_in_lcu) {
+                    return 0;
+                }
+                memcpy(&bs_slice, bs, sizeof(davs2_bs_t));
+                bs_slice.i_bit_pos = (int)((data - bs->p_stream) << 3);
+                parse_slice_position(h, &bs_slice, &lcu_x, &lcu_y);
+                if (lcu_x != 0 || lcu_y >= h->i_height_in_lcu ||
+                    (num_slices > 0 ? lcu_y <= slices[num_slices - 1].i_lcu_y : lcu_y != 0)) {
+                    return 0;
+                }
+
+                slices[num_slices].i_start  = (int)(data - bs->p_stream);
+                slices[num_slices].i_lcu_y  = lcu_y;
+                slices[num_slices].b_parsed = 0;
+                if (num_slices > 0) {
+                    slices[num_slices - 1].i_lcu_y_end = lcu_y;
+                }
+                num_slices++;
+            }
+
+            data += 4;
+            left -= 4;
+        } else {
+            ++data;
+            --left;
+        }
+    }
+
+    if (num_slices < 2) {
+        return 0;
+    }
+    slices[num_slices - 1].i_lcu_y_end = h->i_height_in_lcu;
+    h->p_slices->num_slices = num_slices;
+
+    return num_slices;
+}
+
+/* ---------------------------------------------------------------------------
+ * marks a slice as parsed. the end of the first slice not parsed completely
+ * reports the LCUs of the slices parsed meanwhile, and the end of the last one
+ * finishes the parsing of the picture. returns 1 in that case, the task must
+ * not be touched any more then
+ */
+static int decode_slice_parsed(davs2_t *h, int idx_slice)
+{
+    davs2_slices_t *p_slices = h->p_slices;
+    davs2_mgr_t *mgr = h->task_info.taskmgr;
+    const int num_slices = p_slices->num_slices;
+    int idx_frontier = idx_slice;
+
+    davs2_thread_mutex_lock(&p_slices->mutex);
+    p_slices->slices[idx_slice].b_parsed = 1;
+    if (p_slices->i_frontier == idx_slice) {
+        while (idx_frontier < num_slices && p_slices->slices[idx_frontier].b_parsed) {
+            idx_frontier++;
+        }
+        if (idx_frontier < num_slices) {
+            signal_lcu_parsed(h, h->fdec, p_slices->slices[idx_frontier].i_lcu_y * h->i_width_in_lcu - 1);
+        }
+        davs2_atomic_store(&p_slices->i_frontier, idx_frontier);
+    }
+    davs2_thread_mutex_unlock(&p_slices->mutex);
+
+    if (idx_frontier == num_slices) {
+        int wait_ref_us = davs2_atomic_load(&p_slices->wait_ref_us);
+
+        /* one past the last LCU tells that the parser has finished */
+        signal_lcu_parsed(h, h->fdec, h->i_width_in_lcu * h->i_height_in_lcu);
+        task_frame_parsed(mgr, wait_ref_us);
+        return 1;
+    }
+
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * parses one slice of a picture in the context hs (slice-parallel parsing)
+ */
+static int decode_one_slice(davs2_t *h, davs2_t *hs, int idx_slice)
+{
+    davs2_slice_t *slice = &h->p_slices->slices[idx_slice];
+    davs2_frame_t *frame = h->fref[0];
+    davs2_bs_t bs;
+    int wait_ref_us = 0;
+    int lcu_y;
+
+    davs2_set_thread_bit_depth(h->sample_bit_depth);
+
+    /* the slice header is parsed at the first LCU */
+    memcpy(&bs, h->p_bs, sizeof(davs2_bs_t));
+    bs.i_bit_pos        = slice->i_start << 3;
+    hs->i_slice_index   = idx_slice - 1;
+    hs->i_slice_job     = idx_slice;
+    hs->b_slice_checked = 1;
+
+    for (lcu_y = slice->i_lcu_y; lcu_y < slice->i_lcu_y_end; lcu_y++) {
+        if (frame != NULL) {
+            int64_t t0 = davs2_get_us();
+
+            decoder_wait_lcu_row(hs, frame, lcu_y);
+            wait_ref_us += (int)(davs2_get_us() - t0);
+        }
+
+        /* the end of the slice reports the LCUs left, the rows not parsed
+         * after an error are reported as invalid */
+        if (decode_one_lcu_row_parse(hs, &bs, lcu_y) < 0) {
+            invalidate_lcus(h, (lcu_y + 1) * h->i_width_in_lcu, slice->i_lcu_y_end * h->i_width_in_lcu);
+            break;
+        }
+    }
+
+    davs2_atomic_fetch_add(&h->p_slices->wait_ref_us, wait_ref_us);
+
+    return decode_slice_parsed(h, idx_slice);
+}
+
+/* ---------------------------------------------------------------------------
+ * parses the slices of the picture of generation 'gen' until none is left, in
+ * the parsing context idx_dec (-1: the task itself). returns 1 if the picture
+ * has been finished
+ */
+static int decode_slices(davs2_t *h, int idx_dec, int gen)
+{
+    for (;;) {
+        int claim = davs2_atomic_load(&h->slice_claim);
+
+        if (SLICE_CLAIM_GEN(claim) != gen || SLICE_CLAIM_NEXT(claim) >= SLICE_CLAIM_NUM(claim)) {
+            return 0;
+        }
+        /* a claimed slice keeps the picture, and the task, from being finished */
+        if (davs2_atomic_cas(&h->slice_claim, claim, claim + 1)) {
+            davs2_t *hs = idx_dec < 0 ? h : &h->p_slices->decs[idx_dec];
+
+            if (decode_one_slice(h, hs, SLICE_CLAIM_NEXT(claim))) {
+                return 1;
+            }
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * job parsing slices besides the task (slice-parallel parsing). arg2 holds the
+ * generation of the picture and the parsing context, a job started late only
+ * finds the slices of another picture or none
+ */
+static void *decoder_decode_slices(void *arg1, int arg2)
+{
+    davs2_t *h       = (davs2_t *)arg1;
+    davs2_mgr_t *mgr = h->task_info.taskmgr;
+
+    decode_slices(h, arg2 & 0xFF, arg2 >> 8);
+
+    /* the last job leaving wakes up davs2_decoder_close() */
+    davs2_thread_mutex_lock(&mgr->mutex_mgr);
+    if (davs2_atomic_fetch_add(&mgr->num_slice_jobs, -1) == 1) {
+        davs2_thread_cond_broadcast(&mgr->cond_task);
+    }
+    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * parses the slices found by decode_find_slices in parallel, the task parses
+ * slices as well. the end of the last slice finishes the parsing of the picture
+ */
+static void decode_slices_parallel(davs2_t *h)
+{
+    davs2_mgr_t *mgr         = h->task_info.taskmgr;
+    davs2_slices_t *p_slices = h->p_slices;
+    const int num_slices     = p_slices->num_slices;
+    const int num_jobs       = DAVS2_MIN(num_slices - 1, p_slices->num_decs);
+    const int scu_shift      = h->i_lcu_level - MIN_CU_SIZE_IN_BIT;
+    int gen = (SLICE_CLAIM_GEN(h->slice_claim) + 1) & 0xFF;
+    int i, scu_y;
+
+    p_slices->i_frontier  = 0;
+    p_slices->wait_ref_us = 0;
+
+    /* the parsers check the slice of the neighboring SCUs, and the SCUs above
+     * a slice may not be parsed yet */
+    for (i = 0; i < num_slices; i++) {
+        int scu_y_end = DAVS2_MIN(p_slices->slices[i].i_lcu_y_end << scu_shift, h->i_height_in_scu);
+        for (scu_y = p_slices->slices[i].i_lcu_y << scu_shift; scu_y < scu_y_end; scu_y++) {
+            cu_t *p_cu = &h->scu_data[scu_y * h->i_width_in_scu];
+            int scu_x;
+            for (scu_x = 0; scu_x < h->i_width_in_scu; scu_x++) {
+                p_cu[scu_x].i_slice_nr = (int8_t)i;
+            }
+        }
+    }
+
+    for (i = 0; i < num_jobs; i++) {
+        memcpy(&p_slices->decs[i], h, sizeof(davs2_t));
+    }
+    davs2_atomic_store(&h->slice_claim, SLICE_CLAIM(gen, num_slices, 0));
+
+    /* the task runs on a pool worker (possibly of a pool shared with other
+     * decoders), so the jobs are only queued if a job is free: a blocking
+     * davs2_threadpool_run() could wait for the workers it occupies. the
+     * slices of a job not queued are claimed by the task or the other jobs */
+    for (i = 0; i < num_jobs; i++) {
+        davs2_atomic_fetch_add(&mgr->num_slice_jobs, 1);
+        if (davs2_threadpool_try_run((davs2_threadpool_t *)mgr->thread_pool, decoder_decode_slices, h, (gen << 8) | i,
+                                     DAVS2_JOB_PRIO_HIGH) < 0) {
+            davs2_atomic_fetch_add(&mgr->num_slice_jobs, -1);
+            break;
+        }
+    }
+
+    decode_slices(h, -1, gen);
+}
+
 /**
  * ===========================================================================
  * interface function defines
@@ -793,10 +1264,17 @@ void decoder_free_extra_buffer(davs2_t *h)
         h->p_frame_sao = NULL;
     }
 
+    if (h->p_slices) {
+        davs2_thread_mutex_destroy(&h->p_slices->mutex);
+        h->p_slices = NULL;
+    }
+
     if (h->p_integral) {
         davs2_free(h->p_integral);
         h->p_integral = NULL;
     }
+    h->rec_ring     = NULL;
+    h->num_rec_ring = 0;
 }
 
 /* ---------------------------------------------------------------------------
@@ -804,6 +1282,7 @@ void decoder_free_extra_buffer(davs2_t *h)
  */
 int decoder_alloc_extra_buffer(davs2_t *h)
 {
+    davs2_mgr_t *mgr = h->task_info.taskmgr;
     size_t w_in_spu = h->i_width_in_spu;
     size_t h_in_spu = h->i_height_in_spu;
     size_t w_in_scu = h->i_width_in_scu;
@@ -811,6 +1290,8 @@ int decoder_alloc_extra_buffer(davs2_t *h)
     size_t size_in_spu = w_in_spu * h_in_spu;
     size_t size_in_lcu = ((h->i_width + h->i_lcu_size_sub1) >> h->i_lcu_level) * ((h->i_height + h->i_lcu_size_sub1) >> h->i_lcu_level);
     size_t size_alf = alf_get_buffer_size(h);
+    size_t size_rec_ring = 0;
+    size_t size_slices = 0;
     size_t size_extra_frame = 0;
     size_t mem_size;
 
@@ -818,8 +1299,20 @@ int decoder_alloc_extra_buffer(davs2_t *h)
 
     assert((h->i_width  & 7) == 0);
     assert((h->i_height & 7) == 0);
-    size_extra_frame = 2 * davs2_frame_get_size(h->i_width, h->i_height, h->i_chroma_format, 1);
-    size_extra_frame += (h->b_alf + h->b_sao) * davs2_frame_get_size(h->i_width, h->i_height, h->i_chroma_format, 0);
+    size_extra_frame = 2 * davs2_frame_get_size(h->i_width, h->i_height, h->i_chroma_format, 1, 0);
+    size_extra_frame += (h->b_alf + h->b_sao) * davs2_frame_get_size(h->i_width, h->i_height, h->i_chroma_format, 0, 0);
+    if (mgr->num_rec_thread > 0) {
+        /* coefficients handed over from parsing to reconstruction */
+        int num_rows = DAVS2_MAX(DAVS2_REC_RING_ROWS, mgr->num_rec_thread + 1);
+        size_rec_ring = (size_t)num_rows * h->i_width_in_lcu;
+    }
+    if (mgr->num_rec_thread > 0 && mgr->param.slice_parallel && mgr->num_aec_thread > 1) {
+        /* the slices after the first one are parsed ahead of the reconstruction,
+         * one parsing context per parsing thread besides the task */
+        size_rec_ring = size_in_lcu;
+        size_slices   = sizeof(davs2_slices_t) + sizeof(davs2_slice_t) * h->i_height_in_lcu +
+                        sizeof(davs2_t) * (mgr->num_aec_thread - 1) + CACHE_LINE_SIZE * 2;
+    }
 
     mem_size = sizeof(int8_t)     * (w_in_spu + 16) * (h_in_spu + 1) + /* M1, size of intra prediction mode buffer */
                sizeof(int8_t)     * size_in_spu                      + /* M3, size of prediction direction buffer */
@@ -829,7 +1322,9 @@ int decoder_alloc_extra_buffer(davs2_t *h)
                sizeof(uint8_t)    * w_in_scu * h_in_scu * 2          + /* M7, size of loop filter flag buffer */
                sizeof(lcu_info_t) * size_in_lcu                      + /* M8, size of SAO block parameter buffer */
                sizeof(cu_t)       * h->i_size_in_scu                 + /* M10, size of cu_t */
-               sizeof(pel_t)      * h->i_width * 3                   + /* M13, size of last LCU row bottom border */
+               sizeof(pel_t)      * (h->i_width * 3 + 2 * MAX_CU_SIZE) + /* M13, size of last LCU row bottom border */
+               sizeof(lcu_rec_info_t) * size_rec_ring                + /* M14, size of coefficient ring (pipeline) */
+               size_slices                                           + /* M15, size of slice-parallel parsing */
                size_alf                                              + /* M11, size of ALF */
                size_extra_frame                                      + /* M12, size of extra frame */
                CACHE_LINE_SIZE * 20;
@@ -837,6 +1332,10 @@ int decoder_alloc_extra_buffer(davs2_t *h)
     /* allocate memory for a decoder */
     CHECKED_MALLOC(mem_base, uint8_t *, mem_size);
     h->p_integral = mem_base;   /* pointer which holds the extra buffer */
+    if (mgr->i_mem_node >= 0) {
+        /* fault the pages in on the memory node of the decoding threads (see task_decoder_update) */
+        memset(mem_base, 0, mem_size);
+    }
 
     /* M1, intra prediction mode buffer */
     h->p_ipredmode  = (int8_t *)mem_base;
@@ -882,9 +1381,11 @@ int decoder_alloc_extra_buffer(davs2_t *h)
     mem_base       += h->i_size_in_scu * sizeof(cu_t);
     ALIGN_POINTER(mem_base);
 
-    /* LCU bottom border */
+    /* LCU bottom border. the top-right samples of the last CTUs of a row are
+     * read beyond the picture width, the luma border is padded so that they
+     * do not overlap the chroma borders written by the row below */
     h->intra_border[0] = (pel_t *)mem_base;
-    mem_base += h->i_width * sizeof(pel_t);
+    mem_base += (h->i_width + 2 * MAX_CU_SIZE) * sizeof(pel_t);
     ALIGN_POINTER(mem_base);
     h->intra_border[1] = (pel_t *)mem_base;
     mem_base += h->i_width * sizeof(pel_t);
@@ -893,6 +1394,32 @@ int decoder_alloc_extra_buffer(davs2_t *h)
     mem_base += h->i_width * sizeof(pel_t);
     ALIGN_POINTER(mem_base);
 
+    /* M14, coefficient ring */
+    if (size_rec_ring > 0) {
+        h->rec_ring     = (lcu_rec_info_t *)mem_base;
+        h->num_rec_ring = (int)size_rec_ring;
+        mem_base       += sizeof(lcu_rec_info_t) * size_rec_ring;
+        ALIGN_POINTER(mem_base);
+    }
+
+    /* M15, slice-parallel parsing */
+    if (size_slices > 0) {
+        davs2_slices_t *p_slices = (davs2_slices_t *)mem_base;
+        mem_base += sizeof(davs2_slices_t);
+        ALIGN_POINTER(mem_base);
+        p_slices->decs = (davs2_t *)mem_base;
+        mem_base += sizeof(davs2_t) * (mgr->num_aec_thread - 1);
+        p_slices->slices = (davs2_slice_t *)mem_base;
+        mem_base += sizeof(davs2_slice_t) * h->i_height_in_lcu;
+        ALIGN_POINTER(mem_base);
+
+        p_slices->num_decs   = mgr->num_aec_thread - 1;
+        p_slices->num_slices = 0;
+        p_slices->i_frontier = 0;
+        davs2_thread_mutex_init(&p_slices->mutex, NULL);
+        h->p_slices = p_slices;
+    }
+
     /* ALF */
     h->p_alf        = (alf_var_t *)mem_base;
     mem_base       += size_alf;
@@ -903,20 +1430,20 @@ int decoder_alloc_extra_buffer(davs2_t *h)
      * allocate frame buffers */
 
     // AVS-S
-    h->f_background_ref = davs2_frame_new(h->i_width, h->i_height, h->i_chroma_format, &mem_base, 1);
+    h->f_background_ref = davs2_frame_new(h->i_width, h->i_height, h->i_chroma_format, &mem_base, 1, NULL);
     ALIGN_POINTER(mem_base);
-    h->f_background_cur = davs2_frame_new(h->i_width, h->i_height, h->i_chroma_format, &mem_base, 1);
+    h->f_background_cur = davs2_frame_new(h->i_width, h->i_height, h->i_chroma_format, &mem_base, 1, NULL);
     ALIGN_POINTER(mem_base);
 
     // ALF
     if (h->b_alf) {
-        h->p_frame_alf = davs2_frame_new(h->i_width, h->i_height, h->i_chroma_format, &mem_base, 0);
+        h->p_frame_alf = davs2_frame_new(h->i_width, h->i_height, h->i_chroma_format, &mem_base, 0, NULL);
         ALIGN_POINTER(mem_base);
     }
 
     // SAO
     if (h->b_sao) {
-        h->p_frame_sao = davs2_frame_new(h->i_width, h->i_height, h->i_chroma_format, &mem_base, 0);
+        h->p_frame_sao = davs2_frame_new(h->i_width, h->i_height, h->i_chroma_format, &mem_base, 0, NULL);
         ALIGN_POINTER(mem_base);
     }
 
@@ -954,11 +1481,20 @@ void davs2_write_a_frame(davs2_picture_t *pic, davs2_frame_t *frame)
     pic->bit_depth        = frame->i_output_bit_depth;
     pic->b_decode_error   = frame->frm_decode_error;
     pic->dec_frame        = NULL;
+    pic->buf_opaque       = NULL;
     pic->strides[0] = pic->widths[0] * num_bytes_per_sample;
     pic->strides[1] = pic->widths[1] * num_bytes_per_sample;
     pic->strides[2] = pic->widths[2] * num_bytes_per_sample;
 
-    if (!shift1 && sizeof(pel_t) == num_bytes_per_sample) {
+    if (frame->ext_buf.data != NULL) {
+        /* frame in buffer of the application: output in the internal format */
+        num_bytes_per_sample  = sizeof(pel_t);
+        pic->bytes_per_sample = num_bytes_per_sample;
+        pic->bit_depth        = frame->i_sample_bit_depth;
+        pic->buf_opaque       = frame->ext_buf.buf_opaque;
+    }
+
+    if (frame->ext_buf.data != NULL || (!shift1 && sizeof(pel_t) == num_bytes_per_sample)) {
         pic->dec_frame = frame;
         // TODO: ¸ֵǰָҪʵʱ򣨽֧ʱָ
         pic->planes[0]  = frame->planes[0];
@@ -1107,10 +1643,14 @@ davs2_t *decoder_open(davs2_mgr_t *mgr, davs2_t *h, int idx_decoder)
  */
 void *decoder_decode_picture_data(void *arg1, int arg2)
 {
-    davs2_t *h     = (davs2_t *)arg1;
-    davs2_bs_t *bs = h->p_bs;
+    davs2_t *h       = (davs2_t *)arg1;
+    davs2_bs_t *bs   = h->p_bs;
+    davs2_mgr_t *mgr = h->task_info.taskmgr;
+    int wait_ref_us  = 0;
 
     UNUSED_PARAMETER(arg2);
+    /* the pool threads may serve several streams */
+    davs2_set_thread_bit_depth(h->sample_bit_depth);
     /* decode one frame */
     init_frame(h);
     /* user data and slice header */
@@ -1119,42 +1659,37 @@ void *decoder_decode_picture_data(void *arg1, int arg2)
     /* decode picture data */
     if (h->b_slice_checked != 0) {
         davs2_frame_t *frame = h->fref[0];
-        davs2_mgr_t *mgr = h->task_info.taskmgr;
         const int height_in_lcu = h->i_height_in_lcu;
         int lcu_y;
 
-        /* reset LCU decoding status */
-        memset(h->fdec->num_decoded_lcu_in_row, 0, sizeof(int) * h->i_height_in_lcu);
-
-        // davs2_thread_mutex_lock(&mgr->mutex_aec);
-        // mgr->num_active_decoders++;
-        // davs2_thread_mutex_unlock(&mgr->mutex_aec);
-
-        if (mgr->num_rec_thread && davs2_threadpool_is_free((davs2_threadpool_t *)mgr->thread_pool)) {
-            /* make sure all its dependency frames have started reconstruction */
-            int i;
-            for (i = 0; i < h->num_of_references; i++) {
-                davs2_frame_t *frm = h->fref[i];
-                decoder_wait_lcu_row(h, frm, 0);
-            }
-
-
-            /* run reconstruction thread */
-            davs2_threadpool_run((davs2_threadpool_t *)mgr->thread_pool,
-                                 (davs2_threadpool_func_t)decode_lcu_row_recon, h, 0,
-                                 0);
+        if (h->rec_ring != NULL && h->p_slices != NULL && decode_find_slices(h, bs) > 1) {
             /* -------------------------------------------------------------
-             * parse all LCU rows
+             * parse the slices in parallel, the end of the last slice
+             * finishes the parsing (the task may have been released then)
+             */
+            decode_slices_parallel(h);
+            return NULL;
+        } else if (h->rec_ring != NULL) {
+            /* -------------------------------------------------------------
+             * parse all LCU rows, the reconstruction job is already running
+             * (see decoder_run_reconstruction)
              */
             for (lcu_y = 0; lcu_y < height_in_lcu; lcu_y++) {
                 /* TODO: remove the dependency in this thread */
                 if (frame != NULL) {
+                    int64_t t0 = davs2_get_us();
+
                     decoder_wait_lcu_row(h, frame, lcu_y);
+                    wait_ref_us += (int)(davs2_get_us() - t0);
                 }
 
                 /* parsing the LCU data */
                 decode_one_lcu_row_parse(h, bs, lcu_y);
             }
+
+            /* release the reconstruction even if the parsing stopped half way,
+             * one past the last LCU tells that the parser has finished */
+            signal_lcu_parsed(h, h->fdec, h->i_width_in_lcu * height_in_lcu);
         } else {
             /* -------------------------------------------------------------
              * decode all LCU rows
@@ -1168,28 +1703,42 @@ void *decoder_decode_picture_data(void *arg1, int arg2)
                 decode_one_lcu_row(h, bs, lcu_y);
             }
         }
+    } else if (h->rec_ring != NULL) {
+        /* the reconstruction jobs finish the frame */
+        h->b_rec_no_data = 1;
+        signal_lcu_parsed(h, h->fdec, h->i_width_in_lcu * h->i_height_in_lcu);
     } else {
-        ///!!! make sure that all row signals of frames with 'b_refered_by_others == 1' have been set before return.
-        /// use 'goto fail' instead of 'return' in the half way.
-        if (h->rps.refered_by_others) {
-            // set all row signals before returning.
-            int lcu_y;
-            for (lcu_y = 0; lcu_y < h->i_height_in_lcu; ++lcu_y) {
-                decoder_signal(h, h->fdec, lcu_y);
-            }
-        }
-
-        if (h->i_frame_type == AVS2_G_SLICE) {
-            davs2_frame_copy_planes(h->f_background_ref, h->fdec);
-        }
-
-        /* task is free */
-        task_unload_packet(h, h->task_info.curr_es_unit);
+        decode_finish_empty_frame(h);
     }
 
+    /* the task may have been released already */
+    task_frame_parsed(mgr, wait_ref_us);
+
     return NULL;
 }
 
+/* ---------------------------------------------------------------------------
+ * starts the reconstruction jobs of a frame, one per LCU row (pipeline). the
+ * jobs are started in decoding order, so that the reconstruction of the
+ * reference frames and of the rows above is always ahead in the queue of the
+ * reconstruction threads
+ */
+void decoder_run_reconstruction(davs2_t *h)
+{
+    davs2_mgr_t *mgr = h->task_info.taskmgr;
+    int lcu_y;
+
+    h->num_rec_rows_left  = h->i_height_in_lcu;
+    h->b_rec_no_data      = 0;
+    h->num_flt_rows_ready = 0;
+    h->i_flt_lcu_y        = 0;
+
+    for (lcu_y = 0; lcu_y < h->i_height_in_lcu; lcu_y++) {
+        davs2_threadpool_run((davs2_threadpool_t *)mgr->rec_pool,
+                             (davs2_threadpool_func_t)decode_lcu_row_recon, h, lcu_y, DAVS2_JOB_PRIO_HIGH, 0);
+    }
+}
+
 
 /**
  * ---------------------------------------------------------------------------
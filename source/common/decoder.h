@@ -42,6 +42,8 @@ extern "C" {
 davs2_t *decoder_open(davs2_mgr_t *mgr, davs2_t *h, int idx_decoder);
 #define decoder_decode_picture_data FPFX(decoder_decode_picture_data)
 void *decoder_decode_picture_data(void *arg1, int arg2);
+#define decoder_run_reconstruction FPFX(decoder_run_reconstruction)
+void decoder_run_reconstruction(davs2_t *h);
 #define decoder_close FPFX(decoder_decoder_close)
 void decoder_close(davs2_t *h);
 #define create_freepictures FPFX(create_freepictures)
@@ -57,11 +59,17 @@ void davs2_write_a_frame(davs2_picture_t *pic, davs2_frame_t *frame);
 
 #define task_get_references FPFX(task_get_references)
 int  task_get_references(davs2_t *h, int64_t pts, int64_t dts);
+#define task_skip_picture FPFX(task_skip_picture)
+int  task_skip_picture(davs2_t *h);
 
 #define task_unload_packet FPFX(task_unload_packet)
 void task_unload_packet(davs2_t *h, es_unit_t *es_unit);
+#define task_frame_parsed FPFX(task_frame_parsed)
+void task_frame_parsed(davs2_mgr_t *mgr, int wait_ref_us);
 #define decoder_get_output FPFX(decoder_get_output)
 int decoder_get_output(davs2_mgr_t *mgr, davs2_seq_info_t *headerset, davs2_picture_t *out_frame, int is_flush);
+#define decoder_deliver_output FPFX(decoder_deliver_output)
+void decoder_deliver_output(davs2_mgr_t *mgr, int is_flush);
 
 #ifdef __cplusplus
 }
@@ -44,7 +44,6 @@
  * build */
 #define RELEASE_BUILD           1     /* 1: release build */
 
-#define CTRL_AEC_THREAD         0     /* AEC and reconstruct conducted in different threads */
 #define CTRL_AEC_CONVERSION     0     /* AEC result conversion */
 
 
@@ -216,8 +215,13 @@ enum intra_chroma_pred_mode_e {
 
 /* ---------------------------------------------------------------------------
  * max value */
-#define AVS2_THREAD_MAX        16     /* max number of threads */
-#define DAVS2_WORK_MAX        128     /* max number of works (thread queue) */
+#define AVS2_THREAD_MAX       512     /* max number of threads (sanity check only, all thread data are allocated on demand) */
+#define DAVS2_WORK_MAX        128     /* min number of works (thread queue), grows with the number of threads */
+#define DAVS2_REC_RING_ROWS     2     /* min. LCU rows of coefficients buffered between parsing and reconstruction */
+#define DAVS2_SPIN_COUNT      256     /* polls of a decoding progress before a thread sleeps on it */
+#define DAVS2_MAX_CPUS       1024     /* max number of logical CPUs the threads can be bound to */
+#define DAVS2_MAX_NODES        64     /* max number of NUMA nodes the buffers can be allocated on */
+#define DAVS2_SPLIT_FRAMES     16     /* frames between two adjustments of the frame/row parallelism */
 #define AVS2_MAX_REFS           4     /* max reference frame number */
 #define AVS2_GOP_NUM           32     /* max GOP number */
 #define AVS2_COI_CYCLE        256     /* COI ranges from [0, 255] */
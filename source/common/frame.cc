@@ -35,6 +35,12 @@
 #include "header.h"
 
 
+/* ---------------------------------------------------------------------------
+ * value of the waited progress when no thread sleeps on a progress counter
+ */
+#define FRAME_NOT_WAITED    0x7FFFFFFF
+
+
 /**
  * ===========================================================================
  * border expanding
@@ -172,7 +178,7 @@ align_plane_size(int x, int disalign)
 
 /* ---------------------------------------------------------------------------
  */
-size_t davs2_frame_get_size(int width, int height, int chroma_format, int b_extra)
+size_t davs2_frame_get_size(int width, int height, int chroma_format, int b_extra, int b_ext_planes)
 {
     const int width_c        = width >> 1;
     const int height_c       = height >> (chroma_format == CHROMA_420 ? 1 : 0);
@@ -199,6 +205,11 @@ size_t davs2_frame_get_size(int width, int height, int chroma_format, int b_extr
     size_l   = align_plane_size(stride_l * (height + AVS2_PAD * 2) + CACHE_LINE_SIZE, disalign);
     size_c   = align_plane_size(stride_c * (height_c + AVS2_PAD) + CACHE_LINE_SIZE,   disalign);
 
+    /* planes supplied by the application? */
+    if (b_ext_planes) {
+        size_l = size_c = 0;
+    }
+
     /* compute space size and alloc memory */
     mem_size = sizeof(davs2_frame_t)                      + /* M0, size of frame handle */
                sizeof(pel_t)  * (size_l + size_c * 2)       + /* M1, size of planes buffer: Y+U+V */
@@ -206,14 +217,37 @@ size_t davs2_frame_get_size(int width, int height, int chroma_format, int b_extr
                sizeof(mv_t)   * extra_buf_size              + /* M3, size of SPU motion vector buffer */
                sizeof(davs2_thread_cond_t) * max_lcu_height + /* M4, condition variables for each LCU line */
                sizeof(int) * max_lcu_height                 + /* M5, LCU decoding status */
-               CACHE_LINE_SIZE * 6;
+               sizeof(int) * max_lcu_height                 + /* M6, LCU decoding status waited for */
+               CACHE_LINE_SIZE * 7;
 
     return mem_size;
 }
 
 /* ---------------------------------------------------------------------------
+ * set the plane pointers of a frame to the planes buffer (M1)
  */
-davs2_frame_t *davs2_frame_new(int width, int height, int chroma_format, uint8_t **mem_base, int b_extra)
+static void frame_set_planes(davs2_frame_t *frame, uint8_t *mem_ptr)
+{
+    const int disalign = 1 << 16;
+    int size_l = align_plane_size(frame->i_stride[0] * (frame->i_lines[0] + AVS2_PAD * 2) + CACHE_LINE_SIZE, disalign);
+    int size_c = align_plane_size(frame->i_stride[1] * (frame->i_lines[1] + AVS2_PAD) + CACHE_LINE_SIZE,     disalign);
+
+    frame->planes[0] = (pel_t *)mem_ptr;
+    frame->planes[1] = frame->planes[0] + size_l;
+    frame->planes[2] = frame->planes[1] + size_c;
+
+    /* point to plane data area */
+    frame->planes[0] += frame->i_stride[0] * (AVS2_PAD    ) + (AVS2_PAD    );
+    frame->planes[1] += frame->i_stride[1] * (AVS2_PAD / 2) + (AVS2_PAD / 2);
+    frame->planes[2] += frame->i_stride[2] * (AVS2_PAD / 2) + (AVS2_PAD / 2);
+    ALIGN_POINTER(frame->planes[0]);
+    ALIGN_POINTER(frame->planes[1]);
+    ALIGN_POINTER(frame->planes[2]);
+}
+
+/* ---------------------------------------------------------------------------
+ */
+davs2_frame_t *davs2_frame_new(int width, int height, int chroma_format, uint8_t **mem_base, int b_extra, davs2_param_t *ext_param)
 {
     const int width_c        = width >> 1;
     const int height_c       = height >> (chroma_format == CHROMA_420 ? 1 : 0);
@@ -225,6 +259,7 @@ davs2_frame_t *davs2_frame_new(int width, int height, int chroma_format, uint8_t
     int extra_buf_size = 0;     /* extra buffer size */
     int stride_l, stride_c;
     int size_l, size_c;         /* size of luma and chroma plane */
+    int size_p;                 /* size of planes buffer */
     int i, mem_size;            /* total memory size */
     davs2_frame_t *frame;
     uint8_t *mem_ptr;
@@ -241,15 +276,17 @@ davs2_frame_t *davs2_frame_new(int width, int height, int chroma_format, uint8_t
     stride_c = align_stride(width_c + AVS2_PAD, align, disalign);
     size_l   = align_plane_size(stride_l * (height + AVS2_PAD * 2) + CACHE_LINE_SIZE, disalign);
     size_c   = align_plane_size(stride_c * (height_c + AVS2_PAD) + CACHE_LINE_SIZE,   disalign);
+    size_p   = sizeof(pel_t) * (size_l + size_c * 2);
 
     /* compute space size and alloc memory */
     mem_size = sizeof(davs2_frame_t)                       + /* M0, size of frame handle */
-               sizeof(pel_t)  * (size_l + size_c * 2)       + /* M1, size of planes buffer: Y+U+V */
+               (ext_param != NULL ? 0 : size_p)             + /* M1, size of planes buffer: Y+U+V */
                sizeof(int8_t) * extra_buf_size              + /* M2, size of SPU reference index buffer */
                sizeof(mv_t)   * extra_buf_size              + /* M3, size of SPU motion vector buffer */
                sizeof(davs2_thread_cond_t) * max_lcu_height + /* M4, condition variables for each LCU line */
                sizeof(int) * max_lcu_height                 + /* M5, LCU decoding status */
-               CACHE_LINE_SIZE * 8;
+               sizeof(int) * max_lcu_height                 + /* M6, LCU decoding status waited for */
+               CACHE_LINE_SIZE * 9;
 
     if (mem_base == NULL) {
         CHECKED_MALLOC(mem_ptr, uint8_t *, mem_size);
@@ -279,18 +316,15 @@ davs2_frame_t *davs2_frame_new(int width, int height, int chroma_format, uint8_t
     frame->b_refered_by_others = 0;
 
     /* M1, buffer for planes: Y+U+V */
-    frame->planes[0] = (pel_t *)mem_ptr;
-    frame->planes[1] = frame->planes[0] + size_l;
-    frame->planes[2] = frame->planes[1] + size_c;
-    mem_ptr         += sizeof(pel_t) * (size_l + size_c * 2);
-
-    /* point to plane data area */
-    frame->planes[0] += frame->i_stride[0] * (AVS2_PAD    ) + (AVS2_PAD    );
-    frame->planes[1] += frame->i_stride[1] * (AVS2_PAD / 2) + (AVS2_PAD / 2);
-    frame->planes[2] += frame->i_stride[2] * (AVS2_PAD / 2) + (AVS2_PAD / 2);
-    ALIGN_POINTER(frame->planes[0]);
-    ALIGN_POINTER(frame->planes[1]);
-    ALIGN_POINTER(frame->planes[2]);
+    if (ext_param != NULL) {
+        /* attached by davs2_frame_get_ext_buffer() */
+        frame->ext_param     = ext_param;
+        frame->ext_buf.size  = size_p;
+        frame->ext_buf.align = CACHE_LINE_SIZE;
+    } else {
+        frame_set_planes(frame, mem_ptr);
+        mem_ptr += size_p;
+    }
 
     if (b_extra) {
         /* M2, reference index buffer (in SPU) */
@@ -314,6 +348,11 @@ davs2_frame_t *davs2_frame_new(int width, int height, int chroma_format, uint8_t
     mem_ptr += sizeof(int) * max_lcu_height;
     ALIGN_POINTER(mem_ptr);
 
+    /* M6 */
+    frame->num_waited_lcu_in_row = (int *)mem_ptr;
+    mem_ptr += sizeof(int) * max_lcu_height;
+    ALIGN_POINTER(mem_ptr);
+
     assert(mem_ptr - (uint8_t *)frame <= mem_size);
 
     /* update mem_base */
@@ -325,9 +364,9 @@ davs2_frame_t *davs2_frame_new(int width, int height, int chroma_format, uint8_t
     }
 
     frame->i_conds         = max_lcu_height;
-    frame->i_decoded_line  = -1;
     frame->i_ref_count     = 0;
     frame->i_disposable    = 0;
+    davs2_frame_reset_progress(frame, max_lcu_height);
 
     for (i = 0; i < frame->i_conds; i++) {
         if (davs2_thread_cond_init(&frame->conds_lcu_row[i], NULL)) {
@@ -349,6 +388,145 @@ fail:
     return NULL;
 }
 
+/* ---------------------------------------------------------------------------
+ * wait until a progress counter reaches 'value'. the thread polls the counter
+ * for a while before it sleeps, a sleeping thread registers the smallest value
+ * it waits for in '*p_waited', so that the progress only wakes it up when the
+ * value is reached
+ */
+static void frame_wait_progress(volatile int *p_value, volatile int *p_waited, int value,
+                                davs2_thread_mutex_t *mutex, davs2_thread_cond_t *cond)
+{
+    int i;
+
+    for (i = 0; i < DAVS2_SPIN_COUNT; i++) {
+        if (davs2_atomic_load(p_value) >= value) {
+            return;
+        }
+        davs2_cpu_pause();
+    }
+
+    davs2_thread_mutex_lock(mutex);     /* lock */
+    for (;;) {
+        int waited = *p_waited;
+
+        /* the cas is a full barrier between the registration and the check */
+        davs2_atomic_cas(p_waited, waited, DAVS2_MIN(waited, value));
+        if (davs2_atomic_load(p_value) >= value) {
+            break;
+        }
+        davs2_thread_cond_wait(cond, mutex);
+    }
+    davs2_thread_mutex_unlock(mutex);   /* unlock */
+}
+
+/* ---------------------------------------------------------------------------
+ * advance a progress counter by 'delta', only one thread at a time advances a
+ * counter. the sleeping threads are woken up when one of them is satisfied,
+ * the others register again
+ */
+static void frame_add_progress(volatile int *p_value, volatile int *p_waited, int delta,
+                               davs2_thread_mutex_t *mutex, davs2_thread_cond_t *cond)
+{
+    int value = davs2_atomic_fetch_add(p_value, delta) + delta;
+
+    if (davs2_atomic_load(p_waited) <= value) {
+        davs2_thread_mutex_lock(mutex);     /* lock */
+        davs2_atomic_store(p_waited, FRAME_NOT_WAITED);
+        davs2_thread_cond_broadcast(cond);
+        davs2_thread_mutex_unlock(mutex);   /* unlock */
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * reset the decoding progress of a frame before it is decoded
+ */
+void davs2_frame_reset_progress(davs2_frame_t *frame, int num_lcu_rows)
+{
+    int i;
+
+    frame->i_decoded_line      = -1;
+    frame->i_parsed_lcu_xy     = -1;
+    frame->i_parsed_lcu_waited = FRAME_NOT_WAITED;
+    for (i = 0; i < num_lcu_rows; i++) {
+        frame->num_decoded_lcu_in_row[i] = 0;
+        frame->num_waited_lcu_in_row[i]  = FRAME_NOT_WAITED;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * wait until the LCUs up to 'lcu_xy' (in raster order) are parsed
+ */
+void davs2_frame_wait_parsed(davs2_frame_t *frame, int lcu_xy)
+{
+    frame_wait_progress(&frame->i_parsed_lcu_xy, &frame->i_parsed_lcu_waited, lcu_xy,
+                        &frame->mutex_frm, &frame->cond_aec);
+}
+
+/* ---------------------------------------------------------------------------
+ * mark the LCUs up to 'lcu_xy' as parsed (parsing thread only)
+ */
+void davs2_frame_set_parsed(davs2_frame_t *frame, int lcu_xy)
+{
+    frame_add_progress(&frame->i_parsed_lcu_xy, &frame->i_parsed_lcu_waited, lcu_xy - frame->i_parsed_lcu_xy,
+                       &frame->mutex_frm, &frame->cond_aec);
+}
+
+/* ---------------------------------------------------------------------------
+ * wait until the LCU row 'lcu_y' reaches the decoding status 'num_lcu'
+ */
+void davs2_frame_wait_lcu_row(davs2_frame_t *frame, int lcu_y, int num_lcu)
+{
+    frame_wait_progress(&frame->num_decoded_lcu_in_row[lcu_y], &frame->num_waited_lcu_in_row[lcu_y], num_lcu,
+                        &frame->mutex_recon, &frame->conds_lcu_row[lcu_y]);
+}
+
+/* ---------------------------------------------------------------------------
+ * set the decoding status of the LCU row 'lcu_y' (one thread per row at a time)
+ */
+void davs2_frame_set_lcu_row(davs2_frame_t *frame, int lcu_y, int num_lcu)
+{
+    frame_add_progress(&frame->num_decoded_lcu_in_row[lcu_y], &frame->num_waited_lcu_in_row[lcu_y], num_lcu - frame->num_decoded_lcu_in_row[lcu_y],
+                       &frame->mutex_recon, &frame->conds_lcu_row[lcu_y]);
+}
+
+/* ---------------------------------------------------------------------------
+ * get the planes buffer of a frame from the application
+ */
+int davs2_frame_get_ext_buffer(davs2_frame_t *frame)
+{
+    davs2_param_t *param = frame->ext_param;
+
+    if (param == NULL || frame->ext_buf.data != NULL) {
+        return 0;               /* internal planes, or the buffer is still attached */
+    }
+
+    if (param->get_buffer(param->opaque, &frame->ext_buf) != 0 || frame->ext_buf.data == NULL ||
+        ((intptr_t)frame->ext_buf.data & (frame->ext_buf.align - 1)) != 0) {
+        frame->ext_buf.data = NULL;
+        return -1;
+    }
+
+    frame_set_planes(frame, frame->ext_buf.data);
+
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ * return the planes buffer of a frame to the application
+ */
+void davs2_frame_release_ext_buffer(davs2_frame_t *frame)
+{
+    davs2_param_t *param = frame->ext_param;
+
+    if (param != NULL && frame->ext_buf.data != NULL) {
+        param->release_buffer(param->opaque, &frame->ext_buf);
+        frame->ext_buf.data       = NULL;
+        frame->ext_buf.buf_opaque = NULL;
+        frame->planes[0] = frame->planes[1] = frame->planes[2] = NULL;
+    }
+}
+
 /* ---------------------------------------------------------------------------
  */
 void davs2_frame_destroy(davs2_frame_t *frame)
@@ -359,6 +537,8 @@ void davs2_frame_destroy(davs2_frame_t *frame)
         return;
     }
 
+    davs2_frame_release_ext_buffer(frame);
+
     davs2_thread_mutex_destroy(&frame->mutex_frm);
     davs2_thread_mutex_destroy(&frame->mutex_recon);
 
@@ -42,9 +42,14 @@ extern "C" {
  * ===========================================================================
  */
 #define davs2_frame_get_size FPFX(frame_get_size)
-size_t davs2_frame_get_size(int width, int height, int chroma_format, int b_extra);
+size_t davs2_frame_get_size(int width, int height, int chroma_format, int b_extra, int b_ext_planes);
 #define davs2_frame_new FPFX(frame_new)
-davs2_frame_t *davs2_frame_new(int width, int height, int chroma_format, uint8_t **mem_base, int b_extra);
+davs2_frame_t *davs2_frame_new(int width, int height, int chroma_format, uint8_t **mem_base, int b_extra, davs2_param_t *ext_param);
+
+#define davs2_frame_get_ext_buffer FPFX(frame_get_ext_buffer)
+int davs2_frame_get_ext_buffer(davs2_frame_t *frame);
+#define davs2_frame_release_ext_buffer FPFX(frame_release_ext_buffer)
+void davs2_frame_release_ext_buffer(davs2_frame_t *frame);
 
 #define davs2_frame_destroy FPFX(frame_destroy)
 void davs2_frame_destroy(davs2_frame_t *frame);
@@ -58,6 +63,25 @@ void davs2_frame_copy_lcu(davs2_t *h, davs2_frame_t *p_dst, davs2_frame_t *p_src
 #define davs2_frame_copy_lcurow FPFX(frame_copy_lcurow)
 void davs2_frame_copy_lcurow(davs2_t *h, davs2_frame_t *p_dst, davs2_frame_t *p_src, int i_lcu_y, int pix_offset, int padding_size);
 
+/* ---------------------------------------------------------------------------
+ * decoding status of an LCU row (num_decoded_lcu_in_row[]) in a frame 'w' LCUs
+ * wide: [0, w] LCUs reconstructed (pipeline), LCU_ROW_FILTERED(w, n): the first
+ * n LCUs are final, LCU_ROW_FINISHED(w): the row is final and padded
+ */
+#define LCU_ROW_FILTERED(w, n)   ((w) + 1 + (n))
+#define LCU_ROW_FINISHED(w)      ((w) * 2 + 2)
+
+#define davs2_frame_reset_progress FPFX(frame_reset_progress)
+void davs2_frame_reset_progress(davs2_frame_t *frame, int num_lcu_rows);
+#define davs2_frame_wait_parsed FPFX(frame_wait_parsed)
+void davs2_frame_wait_parsed(davs2_frame_t *frame, int lcu_xy);
+#define davs2_frame_set_parsed FPFX(frame_set_parsed)
+void davs2_frame_set_parsed(davs2_frame_t *frame, int lcu_xy);
+#define davs2_frame_wait_lcu_row FPFX(frame_wait_lcu_row)
+void davs2_frame_wait_lcu_row(davs2_frame_t *frame, int lcu_y, int num_lcu);
+#define davs2_frame_set_lcu_row FPFX(frame_set_lcu_row)
+void davs2_frame_set_lcu_row(davs2_frame_t *frame, int lcu_y, int num_lcu);
+
 #define davs2_frame_expand_border FPFX(frame_expand_border)
 void davs2_frame_expand_border(davs2_frame_t *frame);
 
@@ -44,6 +44,7 @@
 #include "predict.h"
 #include "quant.h"
 #include "cpu.h"
+#include "threadpool.h"
 
 /**
  * ===========================================================================
@@ -113,11 +114,32 @@ static INLINE int is_valid_qp(davs2_t *h, int i_qp)
 
 
 /* ---------------------------------------------------------------------------
+ * initial split of the threads between frame and row parallelism (pipeline),
+ * adjusted later from the waiting times (see task_adapt_frame_parallelism).
+ * a frame without reordering waits for the previous one, most of its rows are
+ * only reconstructed behind it: fewer frames are parsed in parallel
  */
 static
-void davs2_reconfigure_decoder(davs2_mgr_t *h)
+void davs2_reconfigure_decoder(davs2_mgr_t *mgr)
 {
-    UNUSED_PARAMETER(h);
+    davs2_seq_t *seq = &mgr->seq_info;
+    int b_intra_only = seq->num_of_rps > 0;     /* else the RPS are in the picture headers */
+    int i;
+
+    if (mgr->rec_pool == NULL) {
+        return;                 /* no row parallelism */
+    }
+
+    for (i = 0; i < seq->num_of_rps; i++) {
+        b_intra_only &= seq->seq_rps[i].num_of_ref == 0;
+    }
+
+    if (seq->picture_reorder_delay == 0 && !b_intra_only) {
+        mgr->num_frames_max = (mgr->num_aec_thread + 1) >> 1;
+    } else {
+        mgr->num_frames_max = mgr->num_aec_thread;
+    }
+    mgr->num_frames_split = 0;
 }
 
 /* ---------------------------------------------------------------------------
@@ -765,14 +787,15 @@ int parse_picture_header(davs2_t *h, davs2_bs_t *bs, uint32_t start_code)
  */
 
 /* ---------------------------------------------------------------------------
+ * reads the position (in LCUs) of the first LCU of a slice from the slice
+ * header, the bitstream is at the start code of the slice
  */
-void parse_slice_header(davs2_t *h, davs2_bs_t *bs)
+void parse_slice_position(davs2_t *h, davs2_bs_t *bs, int *lcu_x, int *lcu_y)
 {
     int slice_vertical_position;
     int slice_vertical_position_extension = 0;
     int slice_horizontal_positon;
-    int slice_horizontal_positon_extension;
-    int mb_row;
+    int slice_horizontal_positon_extension = 0;
 
     /* skip start code: 00 00 01 */
     bs->i_bit_pos += 24;
@@ -783,17 +806,24 @@ void parse_slice_header(davs2_t *h, davs2_bs_t *bs)
         slice_vertical_position_extension = u_v(bs, 3, "slice vertical position extension");
     }
 
-    if (h->i_image_height > (144 * h->i_lcu_size)) {
-        mb_row = (slice_vertical_position_extension << 7) + slice_vertical_position;
-    } else {
-        mb_row = slice_vertical_position;
-    }
-
     slice_horizontal_positon = u_v(bs, 8, "slice horizontal position");
     if (h->i_width > (255 * h->i_lcu_size)) {
         slice_horizontal_positon_extension = u_v(bs, 2, "slice horizontal position extension");
     }
 
+    *lcu_y = (slice_vertical_position_extension << 7) + slice_vertical_position;
+    *lcu_x = (slice_horizontal_positon_extension << 8) + slice_horizontal_positon;
+}
+
+/* ---------------------------------------------------------------------------
+ */
+void parse_slice_header(davs2_t *h, davs2_bs_t *bs)
+{
+    int lcu_x, lcu_y;
+
+    /* the slices are located by their start codes */
+    parse_slice_position(h, bs, &lcu_x, &lcu_y);
+
     if (!h->b_fixed_picture_qp) {
         h->b_fixed_slice_qp = u_flag(bs, "fixed_slice_qp");
         h->i_slice_qp       = u_v(bs, 7, "slice_qp");
@@ -818,14 +848,15 @@ void parse_slice_header(davs2_t *h, davs2_bs_t *bs)
 
 /* ---------------------------------------------------------------------------
  */
-davs2_outpic_t *alloc_picture(int w, int h)
+davs2_outpic_t *alloc_picture(int w, int h, int b_planes)
 {
     davs2_outpic_t *pic = NULL;
+    size_t size_planes = b_planes ? sizeof(pel_t) * w * h * 3 / 2 : 0;
     uint8_t *buf;
 
     buf = (uint8_t *)davs2_malloc(sizeof(davs2_outpic_t)     +
                                    sizeof(davs2_seq_info_t) +
-                                   sizeof(davs2_picture_t)  + sizeof(pel_t) * w * h * 3 / 2);
+                                   sizeof(davs2_picture_t)  + size_planes);
     if (buf == NULL) {
         return NULL;
     }
@@ -844,9 +875,14 @@ davs2_outpic_t *alloc_picture(int w, int h)
     buf     += sizeof(davs2_picture_t);
 
     pic->pic->num_planes = 3;
-    pic->pic->planes[0] = buf;
-    pic->pic->planes[1] = pic->pic->planes[0] + w * h * sizeof(pel_t);
-    pic->pic->planes[2] = pic->pic->planes[1] + w * h / 4 * sizeof(pel_t);
+    if (b_planes) {
+        pic->pic->planes[0] = buf;
+        pic->pic->planes[1] = pic->pic->planes[0] + w * h * sizeof(pel_t);
+        pic->pic->planes[2] = pic->pic->planes[1] + w * h / 4 * sizeof(pel_t);
+    } else {
+        /* planes are set to the decoded frame on output */
+        pic->pic->planes[0] = pic->pic->planes[1] = pic->pic->planes[2] = NULL;
+    }
     pic->pic->widths[0] = w;
     pic->pic->widths[1] = w / 2;
     pic->pic->widths[2] = w / 2;
@@ -854,6 +890,7 @@ davs2_outpic_t *alloc_picture(int w, int h)
     pic->pic->lines [1] = h / 2;
     pic->pic->lines [2] = h / 2;
     pic->pic->dec_frame = NULL;
+    pic->pic->buf_opaque = NULL;
 
     return pic;
 }
@@ -896,6 +933,17 @@ void destroy_dpb(davs2_mgr_t *mgr)
     mgr->dpb = NULL;
 }
 
+/* ---------------------------------------------------------------------------
+ * places the buffers the decoding threads work on, allocated by the calling
+ * thread, on the memory node of those threads. the calling thread (possibly
+ * the application's) is not re-bound. return 1 if the memory policy saved in
+ * 'saved' has to be restored
+ */
+static int task_set_allocating_node(davs2_mgr_t *mgr, davs2_mem_policy_t *saved)
+{
+    return davs2_cpu_set_mem_node(mgr->i_mem_node, saved);
+}
+
 /* ---------------------------------------------------------------------------
  * create decoding picture buffer(DPB)
  */
@@ -903,6 +951,7 @@ static INLINE
 int create_dpb(davs2_mgr_t *mgr)
 {
     davs2_seq_t *seq = &mgr->seq_info;
+    davs2_param_t *ext_param = mgr->param.get_buffer != NULL ? &mgr->param : NULL;
     uint8_t      *mem_ptr = NULL;
     size_t        mem_size = 0;
     int i;
@@ -911,21 +960,26 @@ int create_dpb(davs2_mgr_t *mgr)
     mgr->dpbsize += 8;  // FIXME: ��Ҫ����
 
     mem_size = mgr->dpbsize * sizeof(davs2_frame_t *)
-        + davs2_frame_get_size(seq->i_enc_width, seq->i_enc_height, seq->head.chroma_format, 1) * mgr->dpbsize
-        + davs2_frame_get_size(seq->i_enc_width, seq->i_enc_height, seq->head.chroma_format, 0)
+        + davs2_frame_get_size(seq->i_enc_width, seq->i_enc_height, seq->head.chroma_format, 1, ext_param != NULL) * mgr->dpbsize
+        + davs2_frame_get_size(seq->i_enc_width, seq->i_enc_height, seq->head.chroma_format, 0, ext_param != NULL)
         + CACHE_LINE_SIZE * (mgr->dpbsize + 2);
 
     mem_ptr = (uint8_t *)davs2_malloc(mem_size);
     if (mem_ptr == NULL) {
         return -1;
     }
+    if (mgr->i_mem_node >= 0) {
+        /* fault the pages in on the memory node of the decoding threads */
+        memset(mem_ptr, 0, mem_size);
+    }
 
     mgr->dpb = (davs2_frame_t **)mem_ptr;
     mem_ptr += mgr->dpbsize * sizeof(davs2_frame_t *);
     ALIGN_POINTER(mem_ptr);
 
     for (i = 0; i < mgr->dpbsize; i++) {
-        mgr->dpb[i] = davs2_frame_new(seq->i_enc_width, seq->i_enc_height, seq->head.chroma_format, &mem_ptr, 1);
+        /* planes of the frames are got from the application when it supplies a frame buffer allocator */
+        mgr->dpb[i] = davs2_frame_new(seq->i_enc_width, seq->i_enc_height, seq->head.chroma_format, &mem_ptr, 1, ext_param);
         ALIGN_POINTER(mem_ptr);
 
         if (mgr->dpb[i] == NULL) {
@@ -937,20 +991,42 @@ int create_dpb(davs2_mgr_t *mgr)
 }
 
 /* ---------------------------------------------------------------------------
+ * set the properties the other threads read from the DPB (with mutex_mgr locked)
  */
 static void init_fdec(davs2_t *h, int64_t pts, int64_t dts)
 {
-    int num_in_spu = h->i_width_in_spu * h->i_height_in_spu;
-    int i;
-
     h->fdec->i_type              = h->i_frame_type;
     h->fdec->i_qp                = h->i_qp;
     h->fdec->i_poc               = h->i_poc;
     h->fdec->i_coi               = h->i_coi;
     h->fdec->b_refered_by_others = h->rps.refered_by_others;
-    h->fdec->i_decoded_line      = -1;
     h->fdec->i_pts               = pts;
     h->fdec->i_dts               = dts;
+}
+
+/* ---------------------------------------------------------------------------
+ * set up the rest of the reconstruction frame, no other thread uses it yet
+ */
+static void init_fdec_buffers(davs2_t *h)
+{
+    int num_in_spu = h->i_width_in_spu * h->i_height_in_spu;
+    int i;
+
+    /* reference frames first, the anchors before the referenced B frames. a frame
+     * is never ahead of its references, whose jobs it would starve when waiting */
+    if (!h->rps.refered_by_others) {
+        h->fdec->i_job_priority = DAVS2_JOB_PRIO_LOW;
+    } else if (h->i_frame_type == AVS2_B_SLICE) {
+        h->fdec->i_job_priority = DAVS2_JOB_PRIO_NORMAL;
+    } else {
+        h->fdec->i_job_priority = DAVS2_JOB_PRIO_HIGH;
+    }
+    for (i = 0; i < h->num_of_references; i++) {
+        h->fdec->i_job_priority = DAVS2_MAX(h->fdec->i_job_priority, h->fref[i]->i_job_priority);
+    }
+
+    /* reset the decoding progress before any thread waits for it */
+    davs2_frame_reset_progress(h->fdec, h->i_height_in_lcu);
 
     for (i = 0; i < AVS2_MAX_REFS; i++) {
         h->fdec->dist_refs[i] = -1;
@@ -992,6 +1068,9 @@ int task_decoder_update(davs2_t *h)
 {
     davs2_mgr_t *mgr  = h->task_info.taskmgr;
     davs2_seq_t *seq  = &mgr->seq_info;
+    davs2_mem_policy_t mem_policy_saved;
+    int b_mem_node;
+    int ret;
 
     if (seq->valid_flag == 0) {
         davs2_log(h, DAVS2_LOG_ERROR, "failed to update decoder (invalid sequence header).");
@@ -1027,7 +1106,13 @@ int task_decoder_update(davs2_t *h)
         h->b_sao            = seq->enable_sao;
         h->b_alf            = seq->enable_alf;
 
-        if (decoder_alloc_extra_buffer(h) < 0) {
+        b_mem_node = task_set_allocating_node(mgr, &mem_policy_saved);
+        ret     = decoder_alloc_extra_buffer(h);
+        if (b_mem_node) {
+            davs2_cpu_restore_mem_node(&mem_policy_saved);
+        }
+
+        if (ret < 0) {
             h->i_lcu_level     = 0;
             h->i_chroma_format = 0;
             h->i_image_width   = 0;
@@ -1057,9 +1142,7 @@ int task_decoder_update(davs2_t *h)
     }
 
 #if HIGH_BIT_DEPTH
-    g_bit_depth   = h->sample_bit_depth;
-    max_pel_value = (1 << g_bit_depth) - 1;
-    g_dc_value    = 1 << (g_bit_depth - 1);
+    davs2_set_thread_bit_depth(h->sample_bit_depth);
 #else
     if (g_bit_depth != h->sample_bit_depth) {
         davs2_log(h, DAVS2_LOG_ERROR, "Un-supported bit-depth %d in this version.\n", h->sample_bit_depth);
@@ -1078,18 +1161,21 @@ int task_decoder_update(davs2_t *h)
 static
 int task_set_sequence_head(davs2_mgr_t *mgr, davs2_seq_t *seq)
 {
+    davs2_mem_policy_t mem_policy_saved;
+    int b_mem_node;
     int ret = 0;
 
     davs2_thread_mutex_lock(&mgr->mutex_mgr);
 
-    davs2_reconfigure_decoder(mgr);
-
     if (seq->valid_flag) {
         int newres = (mgr->seq_info.head.height != seq->head.height || mgr->seq_info.head.width != seq->head.width);
 
         memcpy(&mgr->seq_info, seq, sizeof(davs2_seq_t));
 
         if (newres) {
+            /* the repeated sequence headers keep the adjusted split */
+            davs2_reconfigure_decoder(mgr);
+
             /* resolution changed : new sequence */
             davs2_log(mgr, DAVS2_LOG_INFO, "Sequence Resolution: %dx%d.", seq->head.width, seq->head.height);
             if ((seq->head.width & 0) != 0 || (seq->head.height & 1) != 0) {
@@ -1103,7 +1189,13 @@ int task_set_sequence_head(davs2_mgr_t *mgr, davs2_seq_t *seq)
 
             destroy_dpb(mgr);
 
-            if (create_dpb(mgr) < 0) {
+            b_mem_node = task_set_allocating_node(mgr, &mem_policy_saved);
+            ret     = create_dpb(mgr);
+            if (b_mem_node) {
+                davs2_cpu_restore_mem_node(&mem_policy_saved);
+            }
+
+            if (ret < 0) {
                 /* error */
                 ret = -1;
                 memset(&mgr->seq_info, 0, sizeof(davs2_seq_t));
@@ -1129,6 +1221,9 @@ void clean_one_frame(davs2_frame_t *frame)
     frame->i_coi                = INVALID_FRAME;
     frame->i_disposable         = 0;
     frame->b_refered_by_others  = 0;
+
+    /* no longer needed: return the planes buffer to the application */
+    davs2_frame_release_ext_buffer(frame);
 }
 
 /* ---------------------------------------------------------------------------
@@ -1238,25 +1333,19 @@ int has_blocking(davs2_mgr_t *mgr)
     return 1;
 }
 
+#define IS_VALID_FRAME(frame) ((frame)->i_coi != INVALID_FRAME && (frame)->i_poc != INVALID_FRAME)
+
 /* ---------------------------------------------------------------------------
+ * remove the frames marked by the RPS of the previous picture
+ * (called with mutex_mgr locked)
  */
-int task_get_references(davs2_t *h, int64_t pts, int64_t dts)
+static
+void dpb_remove_frames(davs2_mgr_t *mgr)
 {
-    davs2_mgr_t    *mgr   = h->task_info.taskmgr;
     davs2_frame_t **dpb   = mgr->dpb;
     davs2_frame_t  *frame = NULL;
     int i, j;
 
-#define IS_VALID_FRAME(frame) ((frame)->i_coi != INVALID_FRAME && (frame)->i_poc != INVALID_FRAME)
-
-    davs2_thread_mutex_lock(&mgr->mutex_mgr);
-
-    h->fdec = NULL;
-    h->num_of_references = 0;
-    for (i = 0; i < AVS2_MAX_REFS; i++) {
-        h->fref[i] = NULL;
-    }
-
     for (i = 0; i < mgr->num_frames_to_remove; i++) {
         int coi_frame_to_remove = mgr->coi_remove_frame[i];
 
@@ -1285,7 +1374,85 @@ int task_get_references(davs2_t *h, int64_t pts, int64_t dts)
             davs2_thread_mutex_unlock(&frame->mutex_frm);
         }
     }
+}
+
+/* ---------------------------------------------------------------------------
+ * record the frames the RPS of the current picture removes, they are removed
+ * when the next picture starts (called with mutex_mgr locked)
+ */
+static
+void dpb_set_frames_to_remove(davs2_t *h)
+{
+    davs2_mgr_t *mgr = h->task_info.taskmgr;
+    int i;
+
+    mgr->num_frames_to_remove = h->rps.num_to_remove;
+
+    for (i = 0; i < h->rps.num_to_remove; i++) {
+        mgr->coi_remove_frame[i] = h->i_coi - h->rps.remove_pic[i];
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * drop the current picture in catch-up mode, return 0 if it is dropped
+ * (only a picture no other picture references could be dropped)
+ */
+int task_skip_picture(davs2_t *h)
+{
+    davs2_mgr_t *mgr = h->task_info.taskmgr;
+    int i;
+
+    if (h->rps.refered_by_others || h->i_frame_type == AVS2_G_SLICE || h->i_frame_type == AVS2_GB_SLICE) {
+        return -1;
+    }
+
+    davs2_thread_mutex_lock(&mgr->mutex_mgr);
+
+    /* too late (already passed by the output) or no room to record it */
+    if (h->i_poc < mgr->outpics.output || mgr->outpics.num_skipped >= AVS2_GOP_NUM) {
+        davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+        return -1;
+    }
+
+    h->fdec = NULL;
+    h->num_of_references = 0;
+    for (i = 0; i < AVS2_MAX_REFS; i++) {
+        h->fref[i] = NULL;
+    }
+
+    /* the RPS still applies to the DPB */
+    dpb_remove_frames(mgr);
+    dpb_set_frames_to_remove(h);
+
+    /* let the output pass this POC */
+    mgr->outpics.skipped[mgr->outpics.num_skipped++] = h->i_poc;
+
+    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+    davs2_thread_cond_broadcast(&mgr->cond_output);
 
+    davs2_log(h, DAVS2_LOG_DEBUG, "POC %d skipped (catch-up mode).", h->i_poc);
+
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ */
+int task_get_references(davs2_t *h, int64_t pts, int64_t dts)
+{
+    davs2_mgr_t    *mgr   = h->task_info.taskmgr;
+    davs2_frame_t **dpb   = mgr->dpb;
+    davs2_frame_t  *frame = NULL;
+    int i, j;
+
+    davs2_thread_mutex_lock(&mgr->mutex_mgr);
+
+    h->fdec = NULL;
+    h->num_of_references = 0;
+    for (i = 0; i < AVS2_MAX_REFS; i++) {
+        h->fref[i] = NULL;
+    }
+
+    dpb_remove_frames(mgr);
 
     if (h->i_frame_type == AVS2_GB_SLICE) {
         h->fdec = h->f_background_cur;
@@ -1334,11 +1501,7 @@ int task_get_references(davs2_t *h, int64_t pts, int64_t dts)
         }
 
         /* delete the frame that will never be used */
-        mgr->num_frames_to_remove = h->rps.num_to_remove;
-
-        for (i = 0; i < h->rps.num_to_remove; i++) {
-            mgr->coi_remove_frame[i] = h->i_coi - h->rps.remove_pic[i];
-        }
+        dpb_set_frames_to_remove(h);
 
         /* clean old frames */
         for (i = 0; i < mgr->dpbsize; i++) {
@@ -1460,6 +1623,24 @@ int task_get_references(davs2_t *h, int64_t pts, int64_t dts)
         }
 
         init_fdec(h, pts, dts);
+    }
+
+    /* only the DPB update above is serialized with the other threads */
+    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
+
+    if (h->i_frame_type != AVS2_GB_SLICE) {
+        /* attach a planes buffer from the application */
+        if (davs2_frame_get_ext_buffer(h->fdec) < 0) {
+            davs2_log(h, DAVS2_LOG_ERROR, "failed to get a frame buffer from the application.");
+            davs2_thread_mutex_lock(&h->fdec->mutex_frm);
+            h->fdec->i_disposable = 1;    /* never decoded: drop it once released */
+            davs2_thread_mutex_unlock(&h->fdec->mutex_frm);
+            release_one_frame(h->fdec);   /* for the output thread */
+            davs2_thread_mutex_lock(&mgr->mutex_mgr);
+            goto fail;
+        }
+
+        init_fdec_buffers(h);
 
         if (h->i_frame_type == AVS2_S_SLICE) {
             int num_in_spu = h->i_width_in_spu * h->i_height_in_spu;
@@ -1471,8 +1652,6 @@ int task_get_references(davs2_t *h, int64_t pts, int64_t dts)
         }
     }
 
-    davs2_thread_mutex_unlock(&mgr->mutex_mgr);
-
     return 0;
 
 fail:
@@ -36,6 +36,8 @@
 extern "C" {
 #endif
 
+#define parse_slice_position FPFX(parse_slice_position)
+void parse_slice_position(davs2_t *h, davs2_bs_t *bs, int *lcu_x, int *lcu_y);
 #define parse_slice_header FPFX(parse_slice_header)
 void parse_slice_header(davs2_t *h, davs2_bs_t *bs);
 #define parse_header FPFX(parse_header)
@@ -47,7 +49,7 @@ void release_one_frame(davs2_frame_t *frame);
 void task_release_frames(davs2_t *h);
 
 #define alloc_picture FPFX(alloc_picture)
-davs2_outpic_t *alloc_picture(int w, int h);
+davs2_outpic_t *alloc_picture(int w, int h, int b_planes);
 #define free_picture FPFX(free_picture)
 void free_picture(davs2_outpic_t *pic);
 
@@ -281,23 +281,24 @@ uint32_t get_intra_neighbors(davs2_t *h, int x_4x4, int y_4x4, int bsx, int bsy,
     int b_LEFT      = is_block_available(h, x_4x4, y_4x4, -1, 0, cur_slice_idx);
     int b_TOP       = is_block_available(h, x_4x4, y_4x4,  0, -1, cur_slice_idx);
     int b_TOP_LEFT  = is_block_available(h, x_4x4, y_4x4, -1, -1, cur_slice_idx);
-    int b_LEFT_DOWN = is_block_available(h, x_4x4, y_4x4, -1, (bsy >> 1) - 1, cur_slice_idx);  // (bsy >> MIN_PU_SIZE_IN_BIT << 1)
-    int b_TOP_RIGHT = is_block_available(h, x_4x4, y_4x4, (bsx >> 1) - 1, -1, cur_slice_idx);  // (bsx >> MIN_PU_SIZE_IN_BIT << 1)
+    int b_LEFT_DOWN;
+    int b_TOP_RIGHT;
 
     int leftdown;
     int upright;
     int log2_lcu_size_in_spu = (h->i_lcu_level - B4X4_IN_BIT);
     int i_lcu_mask = (1 << log2_lcu_size_in_spu) - 1;
+    int x_in_lcu = x_4x4 & i_lcu_mask;
+    int y_in_lcu = y_4x4 & i_lcu_mask;
 
     /* 2. ڿǷڵǰ֮ǰع */
-    x_4x4 = x_4x4 & i_lcu_mask;
-    y_4x4 = y_4x4 & i_lcu_mask;
+    leftdown = h->p_tab_DL_avail[((y_in_lcu + (bsy >> 2) - 1) << log2_lcu_size_in_spu) + (x_in_lcu)];
+    upright  = h->p_tab_TR_avail[((y_in_lcu) << log2_lcu_size_in_spu) + (x_in_lcu + (bsx >> 2) - 1)];
 
-    leftdown = h->p_tab_DL_avail[((y_4x4 + (bsy >> 2) - 1) << log2_lcu_size_in_spu) + (x_4x4)];
-    upright  = h->p_tab_TR_avail[((y_4x4) << log2_lcu_size_in_spu) + (x_4x4 + (bsx >> 2) - 1)];
-
-    b_LEFT_DOWN = b_LEFT_DOWN && leftdown;
-    b_TOP_RIGHT = b_TOP_RIGHT && upright;
+    /* the slice of a block not reconstructed yet is not read, the parser may
+     * be writing it (pipeline) */
+    b_LEFT_DOWN = leftdown && is_block_available(h, x_4x4, y_4x4, -1, (bsy >> 1) - 1, cur_slice_idx);  // (bsy >> MIN_PU_SIZE_IN_BIT << 1)
+    b_TOP_RIGHT = upright  && is_block_available(h, x_4x4, y_4x4, (bsx >> 1) - 1, -1, cur_slice_idx);  // (bsx >> MIN_PU_SIZE_IN_BIT << 1)
 
     return (b_LEFT << MD_I_LEFT) | (b_TOP << MD_I_TOP) | (b_TOP_LEFT << MD_I_TOP_LEFT) |
         (b_TOP_RIGHT << MD_I_TOP_RIGHT) | (b_LEFT_DOWN << MD_I_LEFT_DOWN);
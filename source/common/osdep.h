@@ -193,6 +193,12 @@ extern "C" {
 #define ALIGN16(var)        DECLARE_ALIGNED(var, 16)
 #define ALIGN8(var)         DECLARE_ALIGNED(var, 8)
 
+#if defined(_MSC_VER)
+#define DAVS2_THREAD_LOCAL  __declspec(thread)
+#else
+#define DAVS2_THREAD_LOCAL  __thread
+#endif
+
 
 // ARM compiliers don't reliably align stack variables
 // - EABI requires only 8 byte stack alignment to be maintained
@@ -297,6 +303,9 @@ avs2dec_pthread_create(davs2_thread_t *t, void *a, void *(*f)(void *), void *d)
 #define davs2_thread_num_processors_np   pthread_num_processors_np
 #endif
 #define AVS2_PTHREAD_MUTEX_INITIALIZER   PTHREAD_MUTEX_INITIALIZER
+#define davs2_thread_once_t              pthread_once_t
+#define DAVS2_THREAD_ONCE_INIT           PTHREAD_ONCE_INIT
+#define davs2_thread_once                pthread_once
 
 #elif HAVE_WIN32THREAD
 #include "win32thread.h"
@@ -317,11 +326,15 @@ avs2dec_pthread_create(davs2_thread_t *t, void *a, void *(*f)(void *), void *d)
 #define davs2_thread_cond_init(c,f)      0
 #define davs2_thread_cond_destroy(c)
 #define davs2_thread_cond_broadcast(c)
+#define davs2_thread_cond_signal(c)
 #define davs2_thread_cond_wait(c,m)
 #define davs2_thread_attr_t              int
 #define davs2_thread_attr_init(a)        0
 #define davs2_thread_attr_destroy(a)
 #define AVS2_PTHREAD_MUTEX_INITIALIZER   0
+#define davs2_thread_once_t              int
+#define DAVS2_THREAD_ONCE_INIT           0
+#define davs2_thread_once(o,f)           (*(o) ? 0 : (*(o) = 1, (f)(), 0))
 #endif
 
 #if HAVE_WIN32THREAD || PTW32_STATIC_LIB
@@ -358,6 +371,32 @@ int davs2_threading_init(void);
 #define davs2_sleep_ms(x)              usleep(x * 1000)
 #endif
 
+/* ---------------------------------------------------------------------------
+ * atomic operations on 32-bit integers (fetch_add and cas are full barriers)
+ */
+#if defined(_MSC_VER)
+#define davs2_atomic_fetch_add(p,v)    InterlockedExchangeAdd((volatile LONG *)(p), (LONG)(v))
+#define davs2_atomic_cas(p,o,n)        (InterlockedCompareExchange((volatile LONG *)(p), (LONG)(n), (LONG)(o)) == (LONG)(o))
+#define davs2_atomic_load(p)           (*(p))           /* volatile accesses are acquire/release */
+#define davs2_atomic_store(p,v)        (*(p) = (v))
+#else
+#define davs2_atomic_fetch_add(p,v)    __sync_fetch_and_add((p), (v))
+#define davs2_atomic_cas(p,o,n)        __sync_bool_compare_and_swap((p), (o), (n))
+#define davs2_atomic_load(p)           __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define davs2_atomic_store(p,v)        __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+/* hint to the CPU in spin-wait loops */
+#if defined(_MSC_VER)
+#define davs2_cpu_pause()              YieldProcessor()
+#elif defined(__i386__) || defined(__x86_64__)
+#define davs2_cpu_pause()              __asm__ __volatile__("pause")
+#elif defined(__aarch64__)
+#define davs2_cpu_pause()              __asm__ __volatile__("yield")
+#else
+#define davs2_cpu_pause()
+#endif
+
 
 /**
  * ===========================================================================
@@ -46,17 +46,38 @@
  */
 ao_funcs_t gf_davs2 = {0};
 
+/* ---------------------------------------------------------------------------
+ * decoders may be opened concurrently, the table is built by the first one
+ * (under a lock) and is shared by all the others afterwards
+ */
+static davs2_thread_once_t  g_primitives_once = DAVS2_THREAD_ONCE_INIT;
+static davs2_thread_mutex_t g_primitives_mutex;
+
+/* ---------------------------------------------------------------------------
+ */
+static void init_primitives_lock(void)
+{
+    davs2_thread_mutex_init(&g_primitives_mutex, NULL);
+}
+
 /* ---------------------------------------------------------------------------
  */
 void init_all_primitives(uint32_t cpuid)
 {
+    davs2_thread_once(&g_primitives_once, init_primitives_lock);
+    davs2_thread_mutex_lock(&g_primitives_mutex);
+
     if (gf_davs2.initial_count != 0) {
         // already initialed
+        if (gf_davs2.cpuid != cpuid) {
+            davs2_log(NULL, DAVS2_LOG_WARNING, "CPU flags 0x%08x ignored, functions already set up for 0x%08x\n",
+                      cpuid, gf_davs2.cpuid);
+        }
         gf_davs2.initial_count++;
+        davs2_thread_mutex_unlock(&g_primitives_mutex);
         return;
     }
 
-    gf_davs2.initial_count = 1;
     gf_davs2.cpuid         = cpuid;
 
     /* init function handles */
@@ -70,4 +91,8 @@ void init_all_primitives(uint32_t cpuid)
     davs2_sao_init       (cpuid, &gf_davs2);
     davs2_alf_init       (cpuid, &gf_davs2);
 
+    /* the table is complete, later decoders may use it */
+    gf_davs2.initial_count = 1;
+
+    davs2_thread_mutex_unlock(&g_primitives_mutex);
 }
@@ -549,7 +549,7 @@ void sao_lcu(davs2_t *h, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int
     int comp_idx;
     sao_get_neighbor_avail(h, &region, i_lcu_x, i_lcu_y);
     for (comp_idx = 0; comp_idx < IMG_COMPONENTS; comp_idx++) {
-        if (h->slice_sao_on[comp_idx] == 0 || lcu_param->planes[comp_idx].modeIdc == SAO_MODE_OFF) {
+        if (lcu_param->planes[comp_idx].modeIdc == SAO_MODE_OFF) {
             continue;
         }
 
@@ -582,12 +582,53 @@ void sao_lcu(davs2_t *h, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int
     }
 }
 
+/* ---------------------------------------------------------------------------
+ * SAO of one LCU, the LCU row has been copied to p_tmp_frm
+ */
+void sao_lcu_block(davs2_t *h, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int i_lcu_x, int i_lcu_y)
+{
+    sao_t *lcu_param = &h->lcu_infos[i_lcu_y * h->i_width_in_lcu + i_lcu_x].sao_param;
+    sao_region_t region;
+    int comp_idx;
+
+    sao_get_neighbor_avail(h, &region, i_lcu_x, i_lcu_y);
+    for (comp_idx = 0; comp_idx < IMG_COMPONENTS; comp_idx++) {
+        if (lcu_param->planes[comp_idx].modeIdc == SAO_MODE_OFF){
+            continue;
+        }
+        int filter_type = lcu_param->planes[comp_idx].typeIdc;
+        assert(filter_type >= SAO_TYPE_EO_0 && filter_type <= SAO_TYPE_BO);
+
+        int pix_y = region.pix_y[comp_idx];
+        int pix_x = region.pix_x[comp_idx];
+        const int bit_depth = h->sample_bit_depth;
+        int blkoffset = pix_y * p_dec_frm->i_stride[comp_idx] + pix_x;
+        pel_t *dst = p_dec_frm->planes[comp_idx] + blkoffset;
+        pel_t *src = p_tmp_frm->planes[comp_idx] + blkoffset;
+        if (filter_type == SAO_TYPE_BO) {
+            gf_davs2.sao_block_bo(dst, p_dec_frm->i_stride[comp_idx], src, p_dec_frm->i_stride[comp_idx],
+                                  region.width[comp_idx], region.height[comp_idx], bit_depth, &lcu_param->planes[comp_idx]);
+        } else {
+            int avail[8];
+            avail[0] = region.b_top;
+            avail[1] = region.b_down;
+            avail[2] = region.b_left;
+            avail[3] = region.b_right;
+            avail[4] = region.b_top_left;
+            avail[5] = region.b_top_right;
+            avail[6] = region.b_down_left;
+            avail[7] = region.b_right_down;
+            gf_davs2.sao_filter_eo[filter_type](dst, p_dec_frm->i_stride[comp_idx], src, p_dec_frm->i_stride[comp_idx],
+                                                region.width[comp_idx], region.height[comp_idx],
+                                                bit_depth, avail, lcu_param->planes[comp_idx].offset);
+        }
+    }
+}
+
 /* ---------------------------------------------------------------------------
  */
 void sao_lcurow(davs2_t *h, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int i_lcu_y)
 {
-    const int width_in_lcu = h->i_width_in_lcu;
-    int lcu_xy             = i_lcu_y * width_in_lcu;
     int lcu_x;
 
     /* copy one decoded LCU-row */
@@ -595,41 +636,7 @@ void sao_lcurow(davs2_t *h, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm,
 
     /* SAO one LCU-row */
     for (lcu_x = 0; lcu_x < h->i_width_in_lcu; lcu_x++) {
-        sao_region_t region;
-        sao_t *lcu_param = &h->lcu_infos[lcu_xy++].sao_param;
-        int comp_idx;
-        sao_get_neighbor_avail(h, &region, lcu_x, i_lcu_y);
-        for (comp_idx = 0; comp_idx < IMG_COMPONENTS; comp_idx++) {
-            if (h->slice_sao_on[comp_idx] == 0 || lcu_param->planes[comp_idx].modeIdc == SAO_MODE_OFF){
-                continue;
-            }
-            int filter_type = lcu_param->planes[comp_idx].typeIdc;
-            assert(filter_type >= SAO_TYPE_EO_0 && filter_type <= SAO_TYPE_BO);
-
-            int pix_y = region.pix_y[comp_idx];
-            int pix_x = region.pix_x[comp_idx];
-            const int bit_depth = h->sample_bit_depth;
-            int blkoffset = pix_y * p_dec_frm->i_stride[comp_idx] + pix_x;
-            pel_t *dst = p_dec_frm->planes[comp_idx] + blkoffset;
-            pel_t *src = p_tmp_frm->planes[comp_idx] + blkoffset;
-            if (filter_type == SAO_TYPE_BO) {
-                gf_davs2.sao_block_bo(dst, p_dec_frm->i_stride[comp_idx], src, p_dec_frm->i_stride[comp_idx],
-                                      region.width[comp_idx], region.height[comp_idx], bit_depth, &lcu_param->planes[comp_idx]);
-            } else {
-                int avail[8];
-                avail[0] = region.b_top;
-                avail[1] = region.b_down;
-                avail[2] = region.b_left;
-                avail[3] = region.b_right;
-                avail[4] = region.b_top_left;
-                avail[5] = region.b_top_right;
-                avail[6] = region.b_down_left;
-                avail[7] = region.b_right_down;
-                gf_davs2.sao_filter_eo[filter_type](dst, p_dec_frm->i_stride[comp_idx], src, p_dec_frm->i_stride[comp_idx],
-                                                    region.width[comp_idx], region.height[comp_idx],
-                                                    bit_depth, avail, lcu_param->planes[comp_idx].offset);
-            }
-        }
+        sao_lcu_block(h, p_tmp_frm, p_dec_frm, lcu_x, i_lcu_y);
     }
 }
 
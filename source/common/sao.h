@@ -41,6 +41,8 @@ void sao_read_lcu_param(davs2_t *h, int lcu_xy, bool_t *slice_sao_on, sao_t *sao
 
 #define sao_lcu FPFX(sao_lcu)
 void sao_lcu(davs2_t *h, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int i_lcu_x, int i_lcu_y);
+#define sao_lcu_block FPFX(sao_lcu_block)
+void sao_lcu_block(davs2_t *h, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int i_lcu_x, int i_lcu_y);
 #define sao_lcurow FPFX(sao_lcurow)
 void sao_lcurow(davs2_t *h, davs2_frame_t *p_tmp_frm, davs2_frame_t *p_dec_frm, int i_lcu_y);
 
@@ -52,56 +52,203 @@ typedef struct threadpool_job_t {
 } threadpool_job_t;
 
 /* ---------------------------------------------------------------------------
- * synchronized job list
+ * cell of a job ring, the sequence number tells whether it is to be filled or read
+ */
+typedef struct threadpool_cell_t {
+    volatile uint32_t       seq;
+    threadpool_job_t       *job;
+} threadpool_cell_t;
+
+/* ---------------------------------------------------------------------------
+ * bounded lock-free job ring (multiple producers and consumers).
+ * consumers finding it empty sleep on cv_fill, and are woken one per job
+ */
+typedef struct threadpool_ring_t {
+    ALIGN32(volatile uint32_t i_head);  /* next position to push */
+    ALIGN32(volatile uint32_t i_tail);  /* next position to pop */
+    ALIGN32(uint32_t        i_mask);    /* number of cells - 1 */
+    threadpool_cell_t      *cells;
+    volatile int            num_sleeping; /* number of consumers waiting on cv_fill */
+    davs2_thread_mutex_t    mutex;
+    davs2_thread_cond_t     cv_fill;    /* event signaling that a job was pushed */
+} threadpool_ring_t;
+
+/* ---------------------------------------------------------------------------
+ * synchronized job list (finished jobs to be waited for)
  */
 typedef struct davs2_sync_job_list_t {
     int                     i_max_size;
     int                     i_size;
     davs2_thread_mutex_t    mutex;
     davs2_thread_cond_t     cv_fill;  /* event signaling that the list became fuller */
-    davs2_thread_cond_t     cv_empty; /* event signaling that the list became emptier */
-    threadpool_job_t       *list[DAVS2_WORK_MAX + 2];
+    threadpool_job_t      **list;     /* i_max_size entries */
 } davs2_sync_job_list_t;
 
+/* ---------------------------------------------------------------------------
+ * worker thread
+ */
+typedef struct threadpool_worker_t {
+    davs2_threadpool_t     *pool;
+    davs2_thread_t          handle;
+} threadpool_worker_t;
+
 /* ---------------------------------------------------------------------------
  * thread pool
  */
 struct davs2_threadpool_t {
-    int                 i_exit;               /* exit flag */
+    volatile int        i_exit;               /* exit flag */
     int                 num_total_threads;    /* thread number in pool */
     int                 num_run_threads;      /* thread number running */
+    int                 num_jobs;             /* job number in pool */
     davs2_threadpool_func_t init_func;
     void               *init_arg;
     int                 init_arg2;
 
-    /* requires a synchronized list structure and associated methods,
-       so use what is already implemented for jobs */
-    davs2_sync_job_list_t uninit;   /* list of jobs that are awaiting use */
-    davs2_sync_job_list_t run;      /* list of jobs that are queued for processing by the pool */
-    davs2_sync_job_list_t done;     /* list of jobs that have finished processing */
+    threadpool_ring_t     uninit;   /* jobs that are awaiting use */
+    threadpool_ring_t     run[DAVS2_JOB_PRIO_NUM]; /* jobs that are queued for processing by the pool, per priority */
+    davs2_sync_job_list_t done;     /* jobs that have finished processing and are waited for */
 
-    /* handler of threads in the pool */
-    davs2_thread_t        thread_handle[AVS2_THREAD_MAX];
+    /* threads in the pool */
+    threadpool_worker_t  *workers;
 };
 
 
 /**
  * ===========================================================================
- * list operators
+ * ring operators
  * ===========================================================================
  */
 
 /* ---------------------------------------------------------------------------
+ * size: number of cells, a power of 2
  */
-static threadpool_job_t *davs2_job_shift(threadpool_job_t **list)
+static int threadpool_ring_init(threadpool_ring_t *ring, threadpool_cell_t *cells, int size)
 {
-    threadpool_job_t *job = list[0];
     int i;
 
-    for (i = 0; list[i]; i++) {
-        list[i] = list[i + 1];
+    ring->i_head       = 0;
+    ring->i_tail       = 0;
+    ring->i_mask       = (uint32_t)(size - 1);
+    ring->cells        = cells;
+    ring->num_sleeping = 0;
+    for (i = 0; i < size; i++) {
+        cells[i].seq = (uint32_t)i;
+        cells[i].job = NULL;
+    }
+
+    if (davs2_thread_mutex_init(&ring->mutex, NULL) ||
+        davs2_thread_cond_init(&ring->cv_fill, NULL)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+ */
+static void threadpool_ring_delete(threadpool_ring_t *ring)
+{
+    davs2_thread_mutex_destroy(&ring->mutex);
+    davs2_thread_cond_destroy(&ring->cv_fill);
+}
+
+/* ---------------------------------------------------------------------------
+ * push a job and wake up a consumer sleeping on ring 'wake', the ring never
+ * overflows since it has a cell for every job of the pool
+ */
+static void threadpool_ring_push(threadpool_ring_t *ring, threadpool_ring_t *wake, threadpool_job_t *job)
+{
+    threadpool_cell_t *cell;
+    uint32_t pos = davs2_atomic_load(&ring->i_head);
+
+    for (;;) {
+        int32_t dif;
+
+        cell = &ring->cells[pos & ring->i_mask];
+        dif  = (int32_t)(davs2_atomic_load(&cell->seq) - pos);
+        if (dif == 0) {
+            if (davs2_atomic_cas(&ring->i_head, pos, pos + 1)) {
+                break;
+            }
+        }
+        assert(dif >= 0);
+        pos = davs2_atomic_load(&ring->i_head);
+    }
+
+    cell->job = job;
+    davs2_atomic_store(&cell->seq, pos + 1);
+
+    /* wake up one sleeping consumer (the atomic add orders the load after the store above) */
+    if (davs2_atomic_fetch_add(&wake->num_sleeping, 0) > 0) {
+        davs2_thread_mutex_lock(&wake->mutex);
+        davs2_thread_cond_signal(&wake->cv_fill);
+        davs2_thread_mutex_unlock(&wake->mutex);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * pop a job, return NULL if the ring is empty
+ */
+static threadpool_job_t *threadpool_ring_pop(threadpool_ring_t *ring)
+{
+    threadpool_cell_t *cell;
+    threadpool_job_t *job;
+    uint32_t pos = davs2_atomic_load(&ring->i_tail);
+
+    for (;;) {
+        int32_t dif;
+
+        cell = &ring->cells[pos & ring->i_mask];
+        dif  = (int32_t)(davs2_atomic_load(&cell->seq) - (pos + 1));
+        if (dif == 0) {
+            if (davs2_atomic_cas(&ring->i_tail, pos, pos + 1)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return NULL;        /* empty */
+        }
+        pos = davs2_atomic_load(&ring->i_tail);
+    }
+
+    job = cell->job;
+    davs2_atomic_store(&cell->seq, pos + ring->i_mask + 1);
+
+    return job;
+}
+
+/* ---------------------------------------------------------------------------
+ * pop a job from the first non-empty ring, return NULL if all are empty
+ */
+static threadpool_job_t *threadpool_ring_pop_any(threadpool_ring_t *rings, int num_rings)
+{
+    threadpool_job_t *job = NULL;
+    int i;
+
+    for (i = 0; i < num_rings && job == NULL; i++) {
+        job = threadpool_ring_pop(&rings[i]);
+    }
+
+    return job;
+}
+
+/* ---------------------------------------------------------------------------
+ * pop a job from the first non-empty ring, wait until one is pushed if all
+ * are empty (the consumers sleep on the first ring).
+ * return NULL only when the exit flag is set
+ */
+static threadpool_job_t *threadpool_ring_wait(threadpool_ring_t *rings, int num_rings, volatile int *p_exit)
+{
+    threadpool_job_t *job = threadpool_ring_pop_any(rings, num_rings);
+
+    if (job == NULL) {
+        davs2_thread_mutex_lock(&rings->mutex);      /* lock */
+        davs2_atomic_fetch_add(&rings->num_sleeping, 1);
+        while ((job = threadpool_ring_pop_any(rings, num_rings)) == NULL && davs2_atomic_load(p_exit) != AVS2_EXIT_THREAD) {
+            davs2_thread_cond_wait(&rings->cv_fill, &rings->mutex);
+        }
+        davs2_atomic_fetch_add(&rings->num_sleeping, -1);
+        davs2_thread_mutex_unlock(&rings->mutex);    /* unlock */
     }
-    assert(job);
 
     return job;
 }
@@ -114,7 +261,7 @@ static threadpool_job_t *davs2_job_shift(threadpool_job_t **list)
 
 /* ---------------------------------------------------------------------------
  */
-static int davs2_sync_job_list_init(davs2_sync_job_list_t *slist, int i_max_size)
+static int davs2_sync_job_list_init(davs2_sync_job_list_t *slist, threadpool_job_t **list, int i_max_size)
 {
     if (i_max_size < 0) {
         return -1;
@@ -122,11 +269,11 @@ static int davs2_sync_job_list_init(davs2_sync_job_list_t *slist, int i_max_size
 
     slist->i_max_size = i_max_size;
     slist->i_size     = 0;
-    memset(slist->list, 0, sizeof(slist->list));
+    slist->list       = list;
+    memset(slist->list, 0, i_max_size * sizeof(threadpool_job_t *));
 
     if (davs2_thread_mutex_init(&slist->mutex, NULL) ||
-        davs2_thread_cond_init(&slist->cv_fill, NULL) ||
-        davs2_thread_cond_init(&slist->cv_empty, NULL)) {
+        davs2_thread_cond_init(&slist->cv_fill, NULL)) {
         return -1;
     }
 
@@ -139,7 +286,6 @@ static void davs2_threadpool_list_delete(davs2_sync_job_list_t *slist)
 {
     davs2_thread_mutex_destroy(&slist->mutex);
     davs2_thread_cond_destroy(&slist->cv_fill);
-    davs2_thread_cond_destroy(&slist->cv_empty);
     slist->i_size = 0;
 }
 
@@ -148,33 +294,13 @@ static void davs2_threadpool_list_delete(davs2_sync_job_list_t *slist)
 static void davs2_sync_job_list_push(davs2_sync_job_list_t *slist, threadpool_job_t *job)
 {
     davs2_thread_mutex_lock(&slist->mutex);      /* lock */
-    while (slist->i_size == slist->i_max_size) {
-        davs2_thread_cond_wait(&slist->cv_empty, &slist->mutex);
-    }
+    assert(slist->i_size < slist->i_max_size);
     slist->list[slist->i_size++] = job;
     davs2_thread_mutex_unlock(&slist->mutex);    /* unlock */
 
     davs2_thread_cond_broadcast(&slist->cv_fill);
 }
 
-/* ---------------------------------------------------------------------------
- */
-static threadpool_job_t *davs2_sync_job_list_pop(davs2_sync_job_list_t *slist)
-{
-    threadpool_job_t *job;
-
-    davs2_thread_mutex_lock(&slist->mutex);      /* lock */
-    while (!slist->i_size) {
-        davs2_thread_cond_wait(&slist->cv_fill, &slist->mutex);
-    }
-    job = slist->list[--slist->i_size];
-    slist->list[slist->i_size] = NULL;
-    davs2_thread_cond_broadcast(&slist->cv_empty);
-    davs2_thread_mutex_unlock(&slist->mutex);    /* unlock */
-
-    return job;
-}
-
 
 /**
  * ===========================================================================
@@ -187,7 +313,8 @@ static threadpool_job_t *davs2_sync_job_list_pop(davs2_sync_job_list_t *slist)
 static
 void *davs2_threadpool_thread(void *arg)
 {
-    davs2_threadpool_t *pool = (davs2_threadpool_t *)arg;
+    threadpool_worker_t *worker = (threadpool_worker_t *)arg;
+    davs2_threadpool_t *pool = worker->pool;
 
     /* init */
     if (pool->init_func) {
@@ -195,19 +322,9 @@ void *davs2_threadpool_thread(void *arg)
     }
 
     /* loop until exit flag is set */
-    while (pool->i_exit != AVS2_EXIT_THREAD) {
-        threadpool_job_t *job = NULL;
-
+    while (davs2_atomic_load(&pool->i_exit) != AVS2_EXIT_THREAD) {
         /* fetch a job */
-        davs2_thread_mutex_lock(&pool->run.mutex);   /* lock */
-        while (pool->i_exit != AVS2_EXIT_THREAD && !pool->run.i_size) {
-            davs2_thread_cond_wait(&pool->run.cv_fill, &pool->run.mutex);
-        }
-        if (pool->run.i_size) {
-            job = davs2_job_shift(pool->run.list);
-            pool->run.i_size--;
-        }
-        davs2_thread_mutex_unlock(&pool->run.mutex); /* unlock */
+        threadpool_job_t *job = threadpool_ring_wait(pool->run, DAVS2_JOB_PRIO_NUM, &pool->i_exit);
 
         /* do the job */
         if (!job) {
@@ -219,7 +336,7 @@ void *davs2_threadpool_thread(void *arg)
         if (job->wait) {
             davs2_sync_job_list_push(&pool->done, job);
         } else {
-            davs2_sync_job_list_push(&pool->uninit, job);
+            threadpool_ring_push(&pool->uninit, &pool->uninit, job);
         }
     }
 
@@ -233,15 +350,24 @@ int davs2_threadpool_init(davs2_threadpool_t **p_pool, int threads, davs2_thread
     davs2_threadpool_t *pool;
     uint32_t mem_size;
     uint8_t *mem_ptr;
+    int num_jobs;
     int i;
 
-    if (threads <= 0) {
+    if (threads <= 0 || threads > AVS2_THREAD_MAX) {
         return -1;
     }
 
+    /* enough queued jobs to keep every thread busy, a power of 2 for the rings */
+    for (num_jobs = DAVS2_WORK_MAX; num_jobs < threads * 4; num_jobs <<= 1) {
+        ;
+    }
+
     mem_size = sizeof(davs2_threadpool_t)
-        + DAVS2_WORK_MAX * sizeof(threadpool_job_t)
-        + CACHE_LINE_SIZE * (DAVS2_WORK_MAX + 2);
+        + threads * sizeof(threadpool_worker_t)
+        + (1 + DAVS2_JOB_PRIO_NUM) * num_jobs * sizeof(threadpool_cell_t)
+        + num_jobs * sizeof(threadpool_job_t *)
+        + num_jobs * sizeof(threadpool_job_t)
+        + CACHE_LINE_SIZE * (num_jobs + DAVS2_JOB_PRIO_NUM + 4);
 
     CHECKED_MALLOCZERO(mem_ptr, uint8_t *, mem_size);
     *p_pool = pool = (davs2_threadpool_t *)mem_ptr;
@@ -251,24 +377,43 @@ int davs2_threadpool_init(davs2_threadpool_t **p_pool, int threads, davs2_thread
     pool->init_func = init_func;
     pool->init_arg  = init_arg1;
     pool->init_arg2 = init_arg2;
-    pool->num_total_threads = DAVS2_MIN(threads, AVS2_THREAD_MAX);
+    pool->num_total_threads = threads;
     pool->num_run_threads   = 0;
+    pool->num_jobs          = num_jobs;
 
-    if (davs2_sync_job_list_init(&pool->uninit, DAVS2_WORK_MAX) ||
-        davs2_sync_job_list_init(&pool->run,    DAVS2_WORK_MAX) ||
-        davs2_sync_job_list_init(&pool->done,   DAVS2_WORK_MAX)) {
+    pool->workers = (threadpool_worker_t *)mem_ptr;
+    mem_ptr += threads * sizeof(threadpool_worker_t);
+    ALIGN_POINTER(mem_ptr);
+
+    if (threadpool_ring_init(&pool->uninit, (threadpool_cell_t *)mem_ptr, num_jobs)) {
         goto fail;
     }
+    mem_ptr += num_jobs * sizeof(threadpool_cell_t);
+    ALIGN_POINTER(mem_ptr);
+    for (i = 0; i < DAVS2_JOB_PRIO_NUM; i++) {
+        if (threadpool_ring_init(&pool->run[i], (threadpool_cell_t *)mem_ptr, num_jobs)) {
+            goto fail;
+        }
+        mem_ptr += num_jobs * sizeof(threadpool_cell_t);
+        ALIGN_POINTER(mem_ptr);
+    }
+    if (davs2_sync_job_list_init(&pool->done, (threadpool_job_t **)mem_ptr, num_jobs)) {
+        goto fail;
+    }
+    mem_ptr += num_jobs * sizeof(threadpool_job_t *);
+    ALIGN_POINTER(mem_ptr);
 
-    for (i = 0; i < DAVS2_WORK_MAX; i++) {
+    for (i = 0; i < num_jobs; i++) {
         threadpool_job_t *job = (threadpool_job_t *)mem_ptr;
         mem_ptr += sizeof(threadpool_job_t);
         ALIGN_POINTER(mem_ptr);
-        davs2_sync_job_list_push(&pool->uninit, job);
+        threadpool_ring_push(&pool->uninit, &pool->uninit, job);
     }
 
     for (i = 0; i < pool->num_total_threads; i++) {
-        if (davs2_thread_create(pool->thread_handle + i, NULL, davs2_threadpool_thread, pool)) {
+        threadpool_worker_t *worker = &pool->workers[i];
+        worker->pool = pool;
+        if (davs2_thread_create(&worker->handle, NULL, davs2_threadpool_thread, worker)) {
             goto fail;
         }
     }
@@ -280,16 +425,47 @@ fail:
 }
 
 /* ---------------------------------------------------------------------------
+ * the queued jobs of a higher priority (davs2_job_priority_e) are run first,
+ * the jobs of the same priority in order
  */
-void davs2_threadpool_run(davs2_threadpool_t *pool, davs2_threadpool_func_t func, void *arg1, int arg2, int wait_sign)
+void davs2_threadpool_run(davs2_threadpool_t *pool, davs2_threadpool_func_t func, void *arg1, int arg2, int priority, int wait_sign)
 {
-    threadpool_job_t *job = davs2_sync_job_list_pop(&pool->uninit);
+    threadpool_job_t *job = threadpool_ring_wait(&pool->uninit, 1, &pool->i_exit);
+
+    if (job == NULL) {
+        return;                 /* the pool is being deleted */
+    }
 
     job->func = func;
     job->arg1 = arg1;
     job->arg2 = arg2;
     job->wait = wait_sign;
-    davs2_sync_job_list_push(&pool->run, job);
+    assert(priority >= 0 && priority < DAVS2_JOB_PRIO_NUM);
+    threadpool_ring_push(&pool->run[priority], &pool->run[0], job);
+}
+
+/* ---------------------------------------------------------------------------
+ * queue a job not waited for, without blocking. return -1 if no job is free.
+ * davs2_threadpool_run() may block until a job is freed, so the pool workers
+ * queue their jobs through this function (a worker waiting for a free job
+ * could wait for itself)
+ */
+int davs2_threadpool_try_run(davs2_threadpool_t *pool, davs2_threadpool_func_t func, void *arg1, int arg2, int priority)
+{
+    threadpool_job_t *job;
+
+    if (davs2_atomic_load(&pool->i_exit) == AVS2_EXIT_THREAD || (job = threadpool_ring_pop(&pool->uninit)) == NULL) {
+        return -1;
+    }
+
+    job->func = func;
+    job->arg1 = arg1;
+    job->arg2 = arg2;
+    job->wait = 0;
+    assert(priority >= 0 && priority < DAVS2_JOB_PRIO_NUM);
+    threadpool_ring_push(&pool->run[priority], &pool->run[0], job);
+
+    return 0;
 }
 
 /* ---------------------------------------------------------------------------
@@ -297,7 +473,15 @@ void davs2_threadpool_run(davs2_threadpool_t *pool, davs2_threadpool_func_t func
  */
 int davs2_threadpool_is_free(davs2_threadpool_t *pool)
 {
-    return pool->run.i_size <= 0;
+    int i;
+
+    for (i = 0; i < DAVS2_JOB_PRIO_NUM; i++) {
+        if (davs2_atomic_load(&pool->run[i].i_head) != davs2_atomic_load(&pool->run[i].i_tail)) {
+            return 0;
+        }
+    }
+
+    return 1;
 }
 
 /* ---------------------------------------------------------------------------
@@ -313,9 +497,9 @@ void *davs2_threadpool_wait(davs2_threadpool_t *pool, void *arg1, int arg2)
         for (i = 0; i < pool->done.i_size; i++) {
             threadpool_job_t *t = pool->done.list[i];
             if (t->arg1 == arg1 && t->arg2 == arg2) {
-                job = davs2_job_shift(pool->done.list + i);
-                pool->done.i_size--;
-                break;          /* found the job according to arg */
+                job = t;        /* found the job according to arg */
+                pool->done.list[i] = pool->done.list[--pool->done.i_size];
+                break;
             }
         }
         if (!job) {
@@ -325,7 +509,7 @@ void *davs2_threadpool_wait(davs2_threadpool_t *pool, void *arg1, int arg2)
     davs2_thread_mutex_unlock(&pool->done.mutex);    /* unlock */
 
     ret = job->ret;
-    davs2_sync_job_list_push(&pool->uninit, job);
+    threadpool_ring_push(&pool->uninit, &pool->uninit, job);
 
     return ret;
 }
@@ -336,17 +520,19 @@ void davs2_threadpool_delete(davs2_threadpool_t *pool)
 {
     int i;
 
-    davs2_thread_mutex_lock(&pool->run.mutex);   /* lock */
-    pool->i_exit = AVS2_EXIT_THREAD;
-    davs2_thread_cond_broadcast(&pool->run.cv_fill);
-    davs2_thread_mutex_unlock(&pool->run.mutex); /* unlock */
+    davs2_atomic_store(&pool->i_exit, AVS2_EXIT_THREAD);
+    davs2_thread_mutex_lock(&pool->run[0].mutex);   /* lock */
+    davs2_thread_cond_broadcast(&pool->run[0].cv_fill);
+    davs2_thread_mutex_unlock(&pool->run[0].mutex); /* unlock */
 
     for (i = 0; i < pool->num_total_threads; i++) {
-        davs2_thread_join(pool->thread_handle[i], NULL);
+        davs2_thread_join(pool->workers[i].handle, NULL);
     }
 
-    davs2_threadpool_list_delete(&pool->uninit);
-    davs2_threadpool_list_delete(&pool->run);
+    threadpool_ring_delete(&pool->uninit);
+    for (i = 0; i < DAVS2_JOB_PRIO_NUM; i++) {
+        threadpool_ring_delete(&pool->run[i]);
+    }
     davs2_threadpool_list_delete(&pool->done);
     davs2_free(pool);
 }
@@ -39,11 +39,21 @@ extern "C" {
 typedef struct davs2_threadpool_t davs2_threadpool_t;
 typedef void *(*davs2_threadpool_func_t)(void *arg1, int arg2);
 
+/* priorities of the pool jobs, the queued jobs of a higher priority are run first */
+enum davs2_job_priority_e {
+    DAVS2_JOB_PRIO_HIGH   = 0,      /* frames referred to by the other frames (anchors) */
+    DAVS2_JOB_PRIO_NORMAL = 1,      /* B frames referred to by the other frames */
+    DAVS2_JOB_PRIO_LOW    = 2,      /* frames not referred to */
+    DAVS2_JOB_PRIO_NUM    = 3
+};
+
 #define davs2_threadpool_init FPFX(threadpool_init)
 int   davs2_threadpool_init  (davs2_threadpool_t **p_pool, int threads,
                               davs2_threadpool_func_t init_func, void *init_arg1, int init_arg2);
 #define davs2_threadpool_run FPFX(threadpool_run)
-void  davs2_threadpool_run   (davs2_threadpool_t *pool, davs2_threadpool_func_t func, void *arg1, int arg2, int wait_sign);
+void  davs2_threadpool_run   (davs2_threadpool_t *pool, davs2_threadpool_func_t func, void *arg1, int arg2, int priority, int wait_sign);
+#define davs2_threadpool_try_run FPFX(threadpool_try_run)
+int   davs2_threadpool_try_run(davs2_threadpool_t *pool, davs2_threadpool_func_t func, void *arg1, int arg2, int priority);
 #define davs2_threadpool_is_free FPFX(threadpool_is_free)
 int   davs2_threadpool_is_free(davs2_threadpool_t *pool);
 #define davs2_threadpool_wait FPFX(threadpool_wait)
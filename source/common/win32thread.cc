@@ -154,6 +154,21 @@ int davs2_thread_mutex_unlock(davs2_thread_mutex_t *mutex)
     return 0;
 }
 
+/* once: 0 - not run, 1 - running, 2 - done */
+int davs2_thread_once(davs2_thread_once_t *once, void (*init_routine)(void))
+{
+    if (InterlockedCompareExchange(once, 1, 0) == 0) {
+        init_routine();
+        InterlockedExchange(once, 2);
+    } else {
+        while (*once != 2) {
+            Sleep(0);
+        }
+    }
+
+    return 0;
+}
+
 /* for pre-Windows 6.0 platforms we need to define and use our own condition variable and api */
 typedef struct {
     davs2_thread_mutex_t mtx_broadcast;
@@ -97,6 +97,11 @@ int davs2_thread_cond_signal(davs2_thread_cond_t *cond);
 #define davs2_thread_attr_init(a) 0
 #define davs2_thread_attr_destroy(a) 0
 
+typedef volatile LONG davs2_thread_once_t;
+#define DAVS2_THREAD_ONCE_INIT 0
+#define davs2_thread_once FPFX(thread_once)
+int davs2_thread_once(davs2_thread_once_t *once, void (*init_routine)(void));
+
 #define davs2_win32_threading_init FPFX(win32_threading_init)
 int  davs2_win32_threading_init(void);
 #define davs2_win32_threading_destroy FPFX(win32_threading_destroy)
@@ -33,6 +33,7 @@
 #ifndef DAVS2_DAVS2_H
 #define DAVS2_DAVS2_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -41,7 +42,7 @@ extern "C" {    // only need to export C interface if used by C++ source code
 
 /* dAVS2 build version, means different API interface
  * (10 * VER_MAJOR + VER_MINOR) */
-#define DAVS2_BUILD                16
+#define DAVS2_BUILD                17
 
 /**
  * ===========================================================================
@@ -112,6 +113,14 @@ enum davs2_ret_e {
     DAVS2_GOT_FRAME   = 1,    /* Decoding get frame */
     DAVS2_GOT_HEADER  = 2,    /* Decoding get sequence header, always obtained before DAVS2_GOT_FRAME */
     DAVS2_END         = 3,    /* Decoding ended: no more bit-stream to decode and no more frames to output */
+    DAVS2_AGAIN       = 4,    /* All frame decoders are busy, the packet is not consumed: receive frames and send it again */
+};
+
+/* ---------------------------------------------------------------------------
+ * flags of a packet
+ */
+enum davs2_packet_flag_e {
+    DAVS2_PACKET_SKIP_NONREF = 1 << 0,  /* drop the picture if no other picture references it (catch-up) */
 };
 
 /**
@@ -148,6 +157,8 @@ typedef struct davs2_packet_t {
     int             len;              /* bytes of the bitstream */
     int64_t         pts;              /* presentation time stamp */
     int64_t         dts;              /* decoding time stamp */
+    int             flags;            /* davs2_packet_flag_e (since DAVS2_BUILD 17), only read by
+                                       * davs2_decoder_send_packet_flags(). the flags of the last packet of a picture apply */
 } davs2_packet_t;
 
 /* ---------------------------------------------------------------------------
@@ -170,20 +181,94 @@ typedef struct davs2_picture_t {
     int             bit_depth;        /* number of bytes for each sample */
     int             b_decode_error;   /* is there any decoding error of this frame? */
     void           *dec_frame;        /* pointer to decoding frame in DPB (do not change it) */
+    /* additional members for version >= 17 */
+    void           *buf_opaque;       /* user data of the frame buffer from get_buffer(), NULL for internal buffers */
 } davs2_picture_t;
 
+/* ---------------------------------------------------------------------------
+ * frame buffer supplied by the application (see get_buffer() in davs2_param_t)
+ */
+typedef struct davs2_frame_buffer_t {
+    size_t          size;             /* [in]  minimum size of the buffer in bytes */
+    int             align;            /* [in]  required alignment of the buffer in bytes */
+    uint8_t        *data;             /* [out] buffer supplied by the application */
+    void           *buf_opaque;       /* [out] user data of this buffer, passed back by release_buffer() */
+} davs2_frame_buffer_t;
+
 /* ---------------------------------------------------------------------------
  * parameters for create an AVS2 decoder
  */
 typedef struct davs2_param_t {
-    int               threads;        /* decoding threads: 0 for auto */
+    int               threads;        /* decoding threads: 0 for auto (the number of processors). with 'pipeline',
+                                       * up to about 1.5 x threads run, see below */
     int               info_level;     /* only output information which is no less then this level (davs2_log_level_e).
                                          0: All; 1: no debug info; 2: only warning and errors; 3: only errors */
     void             *opaque;         /* user data */
     /* additional parameters for version >= 16 */
     int               disable_avx;    /* 1: disable; 0: default (autodetect) */
+    /* additional parameters for version >= 17 */
+    /* frame buffer allocator (both or neither of them should be set).
+     * when supplied, frames are reconstructed in buffers owned by the application and output without any copy,
+     * the samples are output in the decoder's internal format (bytes_per_sample and bit_depth of the picture).
+     * a buffer is released when it is neither referenced by the decoder nor held by an output picture.
+     * both may be called from any decoding thread */
+    int             (*get_buffer)(void *opaque, davs2_frame_buffer_t *buf);      /* return 0 on success */
+    void            (*release_buffer)(void *opaque, davs2_frame_buffer_t *buf);
+    /* thread pool shared with other decoders (see davs2_thread_pool_open), NULL: the decoder creates its own threads.
+     * when set, 'threads' only limits the number of frames of this stream decoded in parallel */
+    void             *thread_pool;
+    /* 1: low latency output, a frame is output as soon as it is decoded and the frames preceding it in display
+     *    order are out. the reorder window is sized by picture_reorder_delay of the sequence header, and
+     *    davs2_decoder_recv_frame() only waits when more frames are in flight than 'threads' can decode
+     *    in parallel; 0: default */
+    int               low_latency;
+    /* 1: davs2_decoder_send_packet() and davs2_decoder_send_packet_borrowed() return DAVS2_AGAIN instead of
+     *    waiting for a frame decoder to become free; 0: default (wait) */
+    int               non_blocking;
+    /* 1: parse and reconstruct a frame in separate threads, the parser hands the coefficients of each LCU over
+     *    through a ring of a few LCU rows. the reconstruction works on several LCU rows of a frame in wavefront
+     *    order. up to half of 'threads' parse frames in parallel, fewer when the stream gains more from the
+     *    parallel reconstruction of rows (low delay, or frames mostly waiting for their reference frames).
+     *    the decoder creates ceil(threads / 2) parsing threads and threads - 1 reconstruction threads, so that
+     *    a single parser still leaves a thread to every other CPU: up to about 1.5 x threads may be busy,
+     *    set 'threads' to about 2/3 of the CPUs to be given to the decoder;
+     *    2: as 1, and the in-loop filters (deblock, SAO, ALF) and the padding run in separate threads, one LCU row
+     *    behind the reconstruction. the filter threads are taken from the reconstruction threads;
+     *    0: default (a frame is parsed and reconstructed LCU by LCU in one thread) */
+    int               pipeline;
+    /* logical CPUs the threads of this decoder are bound to, such as "0-7,16-23" (only read when the decoder
+     * is opened), NULL: not bound. on Linux the buffers of the decoder are placed in the memory of the first
+     * NUMA node of these CPUs (through the memory policy of the allocating thread, which is not re-bound).
+     * the threads of a shared thread_pool are not bound */
+    const char       *cpu_list;
+    /* 1 + index of the NUMA node whose CPUs are used as cpu_list (ignored when cpu_list is set),
+     * 0: default (not bound) */
+    int               numa_node;
+    /* 1: with 'pipeline', the slices of a picture which all start at the left edge of an LCU row are parsed
+     *    in parallel, by up to as many threads as parse frames. the coefficient ring then holds a whole
+     *    picture instead of a few LCU rows, whether the stream has several slices or not: 12 KB per LCU,
+     *    about 6 MB for 1920x1080 with 64x64 LCUs, for each frame decoded in parallel;
+     *    0: default (the slices are parsed in order) */
+    int               slice_parallel;
 } davs2_param_t;
 
+/* ---------------------------------------------------------------------------
+ * callback for output frames (see davs2_decoder_set_frame_callback)
+ */
+typedef void (*davs2_frame_callback_t)(void *opaque, davs2_seq_info_t *headerset, davs2_picture_t *out_frame);
+
+/* ---------------------------------------------------------------------------
+ * callback for the progress of decoding frames (see davs2_decoder_set_rows_callback).
+ * pic describes the frame being decoded in the decoder's internal format (read only),
+ * luma lines [0, num_lines) and the corresponding chroma lines are final (after deblock, SAO and ALF)
+ */
+typedef void (*davs2_rows_callback_t)(void *opaque, davs2_picture_t *pic, int num_lines);
+
+/* ---------------------------------------------------------------------------
+ * callback to give back a bitstream buffer lent to the decoder (see davs2_decoder_send_packet_borrowed)
+ */
+typedef void (*davs2_packet_release_t)(void *opaque, const uint8_t *data);
+
 /**
  * ===========================================================================
  * interface function declares (DAVS2 library APIs for AVS2 video decoder)
@@ -213,6 +298,39 @@ davs2_decoder_open(davs2_param_t *param);
 DAVS2_API int
 davs2_decoder_send_packet(void *decoder, davs2_packet_t *packet);
 
+/**
+ * ---------------------------------------------------------------------------
+ * Function   : decode one frame, honouring packet->flags
+ * Parameters :
+ *       [in] : decoder   - pointer to the AVS2 decoder handler
+ *       [in] : packet    - pointer to struct davs2_packet_t, packet->flags must be set
+ * Return     : see definition of davs2_ret_e
+ * Note       : available since DAVS2_BUILD 17. davs2_decoder_send_packet() and
+ *              davs2_decoder_send_packet_borrowed() ignore packet->flags
+ * ---------------------------------------------------------------------------
+ */
+DAVS2_API int
+davs2_decoder_send_packet_flags(void *decoder, davs2_packet_t *packet);
+
+/**
+ * ---------------------------------------------------------------------------
+ * Function   : decode one frame from a bitstream buffer lent by the application (no copy)
+ * Parameters :
+ *       [in] : decoder   - pointer to the AVS2 decoder handler
+ *       [in] : packet    - pointer to struct davs2_packet_t, holding complete decodable units
+ *                          (e.g. one whole picture, optionally preceded by a sequence header)
+ *       [in] : release   - called once the decoder is done with packet->data (may be NULL)
+ *       [in] : opaque    - user data passed to the callback
+ * Return     : see definition of davs2_ret_e
+ * Note       : the buffer must be writable and stay valid until it is released, the pseudo start
+ *              codes are removed in place. the release callback may be called from any decoding
+ *              thread, or before this function returns. it is always called, even on error, but
+ *              not on DAVS2_AGAIN (non_blocking mode), when the packet should be sent again
+ * ---------------------------------------------------------------------------
+ */
+DAVS2_API int
+davs2_decoder_send_packet_borrowed(void *decoder, davs2_packet_t *packet, davs2_packet_release_t release, void *opaque);
+
 /**
  * ---------------------------------------------------------------------------
  * Function   : decode one frame
@@ -251,6 +369,54 @@ davs2_decoder_flush(void *decoder, davs2_seq_info_t *headerset, davs2_picture_t
 DAVS2_API void
 davs2_decoder_frame_unref(void *decoder, davs2_picture_t *out_frame);
 
+/**
+ * ---------------------------------------------------------------------------
+ * Function   : set a callback to receive output frames
+ * Parameters :
+ *       [in] : decoder   - decoder handle
+ *       [in] : callback  - called with each frame in display order as soon as it is decoded (NULL: disable)
+ *       [in] : opaque    - user data passed to the callback
+ * Return     : 0 for success, -1 when there are frames not output yet
+ * Note       : the callback is called from the decoding threads (or davs2_decoder_flush()), one frame at a time.
+ *              each frame should be released by davs2_decoder_frame_unref(). when the callback is set,
+ *              davs2_decoder_recv_frame() and davs2_decoder_flush() return no frames but sequence headers.
+ * ---------------------------------------------------------------------------
+ */
+DAVS2_API int
+davs2_decoder_set_frame_callback(void *decoder, davs2_frame_callback_t callback, void *opaque);
+
+/**
+ * ---------------------------------------------------------------------------
+ * Function   : set a callback to receive the decoding progress of each frame (LCU-row granularity)
+ * Parameters :
+ *       [in] : decoder   - decoder handle
+ *       [in] : callback  - called each time more lines of a frame become final (NULL: disable)
+ *       [in] : opaque    - user data passed to the callback
+ * Return     : 0 for success, -1 when there are frames not output yet
+ * Note       : the callback is called from the decoding threads, in increasing order of num_lines for one
+ *              frame, the last call of a frame has num_lines equal to its height. frames decoded in parallel
+ *              report concurrently, in decoding order (identified by pic_order_count). the samples stay
+ *              valid until the frame is output and released, and should not be modified
+ * ---------------------------------------------------------------------------
+ */
+DAVS2_API int
+davs2_decoder_set_rows_callback(void *decoder, davs2_rows_callback_t callback, void *opaque);
+
+/**
+ * ---------------------------------------------------------------------------
+ * Function   : switch the catch-up mode
+ * Parameters :
+ *       [in] : decoder   - decoder handle
+ *       [in] : enable    - 1: drop the pictures no other picture references instead of decoding them, 0: decode all
+ * Return     : none
+ * Note       : meant for live streams falling behind real time. it may be called from any thread and applies to
+ *              the pictures sent afterwards, the dropped pictures are not output. the flag DAVS2_PACKET_SKIP_NONREF
+ *              of a packet sent by davs2_decoder_send_packet_flags() drops a single picture
+ * ---------------------------------------------------------------------------
+ */
+DAVS2_API void
+davs2_decoder_set_catch_up(void *decoder, int enable);
+
 /**
  * ---------------------------------------------------------------------------
  * Function   : close the AVS2 decoder
@@ -262,6 +428,32 @@ davs2_decoder_frame_unref(void *decoder, davs2_picture_t *out_frame);
 DAVS2_API void
 davs2_decoder_close(void *decoder);
 
+/**
+ * ---------------------------------------------------------------------------
+ * Function   : create a thread pool to be shared by several decoders
+ * Parameters :
+ *       [in] : threads - number of threads (0: number of processors)
+ * Return     : handle of the thread pool, zero for failure
+ * Note       : attach decoders through davs2_param_t.thread_pool. the pictures of all the attached
+ *              decoders are run in the order they are queued (the pictures referred to by others first),
+ *              not in turn per decoder: a decoder only gets its share of the threads through its 'threads',
+ *              which bounds its pictures in flight. close it after all the attached decoders are closed
+ * ---------------------------------------------------------------------------
+ */
+DAVS2_API void *
+davs2_thread_pool_open(int threads);
+
+/**
+ * ---------------------------------------------------------------------------
+ * Function   : close a shared thread pool
+ * Parameters :
+ *       [in] : thread_pool - thread pool handle
+ * Return     : none
+ * ---------------------------------------------------------------------------
+ */
+DAVS2_API void
+davs2_thread_pool_close(void *thread_pool);
+
 #ifdef __cplusplus
 }
 #endif
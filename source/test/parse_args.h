@@ -51,6 +51,13 @@ typedef struct davs2_input_param_t {
     int g_verbose;
     int g_psnr;
     int g_threads;
+    int b_low_latency;
+    int b_pipeline;
+    int b_catch_up; // drop the non-reference pictures
+    int b_slice_parallel; // parse the slices of a picture in parallel (pipeline)
+    int g_scaling; // max threads of the scaling test, 0: disabled
+    const char *s_cpu_list; // CPUs the decoding threads are bound to
+    int i_numa_node;        // 1 + NUMA node the decoding threads are bound to, 0: not bound
     int b_y4m;     // Y4M or YUV
 
     FILE *g_infile;
@@ -63,7 +70,7 @@ typedef struct davs2_input_param_t {
 #endif
 
 /* 包含附加参数的，在字母后面需要加上冒号 */
-static const char *optString = "i:o:r:m:t:vh?";
+static const char *optString = "i:o:r:m:t:s:c:n:lp::uSvh?";
 
 static const struct option longOpts[] = {
     {"input",   required_argument, NULL, 'i'},
@@ -71,6 +78,13 @@ static const struct option longOpts[] = {
     {"psnr",    required_argument, NULL, 'r'},
     {"md5",     required_argument, NULL, 'm'},
     {"threads", required_argument, NULL, 't'},
+    {"lowlatency", no_argument, NULL, 'l'},
+    {"pipeline", optional_argument, NULL, 'p'},
+    {"catchup", no_argument, NULL, 'u'},
+    {"slices",  no_argument, NULL, 'S'},
+    {"scaling", required_argument, NULL, 's'},
+    {"cpus",    required_argument, NULL, 'c'},
+    {"numa",    required_argument, NULL, 'n'},
     {"verbose", no_argument, NULL, 'v'},
     {"help",    no_argument, NULL, 'h'},
     {NULL, no_argument, NULL, 0}
@@ -82,7 +96,7 @@ static const struct option longOpts[] = {
 static void display_usage(void)
 {
     /* 运行参数说明 */
-    const char * usage = "usage: davs2 -i avs2file -o outputfile [-r recfile] [-t threads] [-v]";
+    const char * usage = "usage: davs2 -i avs2file -o outputfile [-r recfile] [-t threads] [-l] [-p[2]] [-u] [-S] [-s threads] [-c cpus] [-n node] [-v]";
 
     show_message(CONSOLE_RED, "davs2 parameters\n    %s\n", usage);
     show_message(CONSOLE_RED, "+------------------+-------------+-------------------------------------------+\n");
@@ -92,6 +106,14 @@ static void display_usage(void)
     show_message(CONSOLE_RED, "| --output=dec.yuv | -o dec.yuv  | output YUV/Y4M file path                  |\n");
     show_message(CONSOLE_RED, "| --psnr=rec.yuv   | -r rec.yuv  | reference reconstruction YUV file         |\n");
     show_message(CONSOLE_RED, "| --threads=N      | -t N        | threads for decoding (default: 1)         |\n");
+    show_message(CONSOLE_RED, "| --lowlatency     | -l          | Output each frame as soon as decoded      |\n");
+    show_message(CONSOLE_RED, "| --pipeline[=2]   | -p[2]       | Parse and reconstruct in separate threads |\n");
+    show_message(CONSOLE_RED, "|                  |             | 2: also filter in separate threads        |\n");
+    show_message(CONSOLE_RED, "| --catchup        | -u          | Drop the non-reference pictures           |\n");
+    show_message(CONSOLE_RED, "| --slices         | -S          | Parse the slices in parallel (pipeline)   |\n");
+    show_message(CONSOLE_RED, "| --scaling=N      | -s N        | Report speed with 1, 2, 4 ... N threads   |\n");
+    show_message(CONSOLE_RED, "| --cpus=0-7,16    | -c 0-7,16   | Bind the decoding threads to these CPUs   |\n");
+    show_message(CONSOLE_RED, "| --numa=N         | -n N        | Bind the decoding threads to NUMA node N  |\n");
     show_message(CONSOLE_RED, "| --md5=M          | -m M        | Reference MD5 of decoded YUV              |\n");
     show_message(CONSOLE_RED, "| --verbose        | -v          | Enable decoding status every frame        |\n");
     show_message(CONSOLE_RED, "| --help           | -h          | Showing this instruction                  |\n");
@@ -128,6 +150,13 @@ static int parse_args(davs2_input_param_t *p_param, int argc, char **argv)
     p_param->g_verbose = 0;
     p_param->g_psnr    = 0;
     p_param->g_threads = 1;
+    p_param->b_low_latency = 0;
+    p_param->b_pipeline = 0;
+    p_param->b_catch_up = 0;
+    p_param->b_slice_parallel = 0;
+    p_param->g_scaling = 0;
+    p_param->s_cpu_list  = NULL;
+    p_param->i_numa_node = 0;
     p_param->b_y4m     = 0;
 
     opt = getopt_long(argc, argv, optString, longOpts, &longIndex);
@@ -151,6 +180,27 @@ static int parse_args(davs2_input_param_t *p_param, int argc, char **argv)
         case 't':
             p_param->g_threads = atoi(optarg);
             break;
+        case 'l':
+            p_param->b_low_latency = 1;
+            break;
+        case 'p':
+            p_param->b_pipeline = optarg != NULL ? atoi(optarg) : 1;
+            break;
+        case 'u':
+            p_param->b_catch_up = 1;
+            break;
+        case 'S':
+            p_param->b_slice_parallel = 1;
+            break;
+        case 's':
+            p_param->g_scaling = atoi(optarg);
+            break;
+        case 'c':
+            p_param->s_cpu_list = optarg;
+            break;
+        case 'n':
+            p_param->i_numa_node = atoi(optarg) + 1;
+            break;
         case 'h':   /* fall-through is intentional */
         case '?':
             display_usage();
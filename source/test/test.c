@@ -175,8 +175,9 @@ void output_decoded_frame(davs2_picture_t *pic, davs2_seq_info_t *headerset, int
  * data_buf - pointer to bitstream buffer
  * data_len - number of bytes in bitstream buffer
  * frames   - number of frames in bitstream buffer
+ * return the decoding time in seconds
  */
-void test_decoder(uint8_t *data_buf, int data_len, int num_frames, char *dst)
+double test_decoder(uint8_t *data_buf, int data_len, int num_frames, char *dst)
 {
     const double f_time_fac = 1.0 / (double)CLOCKS_PER_SEC;
     davs2_param_t    param;      // decoding parameters
@@ -200,11 +201,19 @@ void test_decoder(uint8_t *data_buf, int data_len, int num_frames, char *dst)
     /* init the decoder */
     memset(&param, 0, sizeof(param));
     param.threads      = inputparam.g_threads;
+    param.low_latency  = inputparam.b_low_latency;
+    param.pipeline     = inputparam.b_pipeline;
+    param.slice_parallel = inputparam.b_slice_parallel;
+    param.cpu_list     = inputparam.s_cpu_list;
+    param.numa_node    = inputparam.i_numa_node;
     param.opaque       = (void *)(intptr_t)num_frames;
     param.info_level   = DAVS2_LOG_DEBUG;
     param.disable_avx  = 0; // on some platforms, disable AVX (setting to 1) would be faster
 
     decoder = davs2_decoder_open(&param);
+    if (inputparam.b_catch_up) {
+        davs2_decoder_set_catch_up(decoder, 1);
+    }
 
     time0 = get_time();
 
@@ -220,8 +229,9 @@ void test_decoder(uint8_t *data_buf, int data_len, int num_frames, char *dst)
             len = data_len;
         }
 
-        packet.data = data;
-        packet.len  = len;
+        packet.data  = data;
+        packet.len   = len;
+        packet.flags = 0;
 
         // set PTS/DTS, which was only used to check whether they could be passed out rightly
         packet.pts  =  user_dts;
@@ -297,6 +307,57 @@ void test_decoder(uint8_t *data_buf, int data_len, int num_frames, char *dst)
     show_message(CONSOLE_GREEN, "total decoding time: %.3lfs, %6.2lf fps\n", 
         (double)((time1 - time0) * f_time_fac), 
         (double)(g_frmcount / ((time1 - time0) * f_time_fac)));
+
+    return (double)((time1 - time0) * f_time_fac);
+}
+
+/* ---------------------------------------------------------------------------
+ * decode the bitstream with 1, 2, 4, ... max_threads threads (no output)
+ * and report the speed-up of each
+ */
+static void test_scaling(uint8_t *data_buf, int data_len, int num_frames, char *dst, int max_threads)
+{
+    FILE  *outfile = inputparam.g_outfile;
+    int    psnr    = inputparam.g_psnr;
+    int    y4m     = inputparam.b_y4m;
+    int    threads[32];
+    double times[32];
+    int    frames[32];
+    int    num_runs = 0;
+    int    t = 1;
+    int    i;
+
+    inputparam.g_outfile = NULL;
+    inputparam.g_psnr    = 0;
+    inputparam.b_y4m     = 0;
+
+    for (;;) {
+        g_frmcount           = 0;
+        inputparam.g_threads = t;
+        show_message(CONSOLE_WHITE, "\n--- scaling test: %d thread(s) ---\n", t);
+        threads[num_runs] = t;
+        times[num_runs]   = test_decoder(data_buf, data_len, num_frames, dst);
+        frames[num_runs]  = g_frmcount;
+        num_runs++;
+
+        if (t >= max_threads || num_runs == 32) {
+            break;
+        }
+        t = (t * 2 < max_threads) ? t * 2 : max_threads;
+    }
+
+    inputparam.g_outfile = outfile;
+    inputparam.g_psnr    = psnr;
+    inputparam.b_y4m     = y4m;
+
+    show_message(CONSOLE_WHITE, "\n--------------------------------------------------\n");
+    show_message(CONSOLE_GREEN, " threads     time(s)       fps   speed-up  efficiency\n");
+    for (i = 0; i < num_runs; i++) {
+        double fps     = times[i] > 0 ? frames[i] / times[i] : 0;
+        double speedup = times[i] > 0 ? times[0] / times[i] : 0;
+        show_message(CONSOLE_GREEN, " %7d  %10.3lf  %8.2lf  %8.2lfx  %9.1lf%%\n",
+                     threads[i], times[i], fps, speedup, 100.0 * speedup / threads[i]);
+    }
 }
 
 /* ---------------------------------------------------------------------------
@@ -326,7 +387,11 @@ int main(int argc, char *argv[])
     }
 
     /* test decoding */
-    test_decoder(data, size, frames, dst);
+    if (inputparam.g_scaling > 0) {
+        test_scaling(data, size, frames, dst, inputparam.g_scaling);
+    } else {
+        test_decoder(data, size, frames, dst);
+    }
 
     show_message(CONSOLE_WHITE, "\n Decoder Total Time: %.3lf s\n", (clock() - tm_start) / (double)(CLOCKS_PER_SEC));
 